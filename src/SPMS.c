@@ -9,10 +9,13 @@
 // JIN Yixiao
 //
 
+#include "batch.h"
 #include "input.h"
+#include "opti.h"
 #include "output.h"
 #include "scheduler.h"
 #include "state.h"
+#include "resource.h"
 #include "rng.h"
 #include "utils.h"
 
@@ -23,9 +26,109 @@
 #include <time.h>
 
 
-int main() {
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-b dense|persistent|sparse|counting|diff] [-H YYYY-MM-DD:YYYY-MM-DD] [-r resources-file] [-j workers] [-t threads] [-B batch-file] [-C batch-file:compiled-file]\n", prog);
+    fprintf(stderr, "  -b    Tracker backend of all schedulers (default: dense for FCFS and PRIO,\n");
+    fprintf(stderr, "        persistent for OPTI). \"diff\" cross-checks the persistent, sparse\n");
+    fprintf(stderr, "        and counting backends against the dense one on every operation.\n");
+    fprintf(stderr, "  -H    First and last day bookings may use (default: 2025-05-10:2025-05-16).\n");
+    fprintf(stderr, "        Up to ten years; every backend only allocates the days that get bookings.\n");
+    fprintf(stderr, "  -r    Load resource types and capacities from a file (see resources.cfg).\n");
+    fprintf(stderr, "  -j    Number of OPTI annealing chains run in parallel, keeping the best\n");
+    fprintf(stderr, "        (default: 1, 0: one per online CPU).\n");
+    fprintf(stderr, "  -t    Number of threads parsing a batch file of %d KiB or more in chunks\n", 2 * PARALLEL_CHUNK_MIN >> 10);
+    fprintf(stderr, "        (default: 0, one per online CPU; 1 parses it line by line).\n");
+    fprintf(stderr, "  -B    Only measure how fast a batch file is parsed, by each reader, and exit.\n");
+    fprintf(stderr, "  -C    Only compile a batch file into one that addBatch loads without parsing,\n");
+    fprintf(stderr, "        and exit. It only loads with the same -r and -H options.\n");
+}
+
+int main(int argc, char* argv[]) {
     int invalid_cnt = 0;
     seed(1389ULL, 74135ULL);
+
+    const char* benchmark_file = NULL;
+    const char* compile_arg = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:H:r:j:t:B:C:")) != -1) {
+        switch (opt) {
+            case 'b': {
+                TrackerBackend backend;
+                if (!tracker_parse_backend(optarg, &backend)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                tracker_set_default_backend(backend);
+                break;
+            }
+            case 'H': {
+                char first[DATE_STRING_LEN] = "";
+                const char* colon = strchr(optarg, ':');
+                if (colon != NULL && colon - optarg < DATE_STRING_LEN) {
+                    memcpy(first, optarg, (size_t)(colon - optarg));
+                    first[colon - optarg] = '\0';
+                }
+                if (colon == NULL || !set_horizon(first, colon + 1)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            }
+            case 'r':
+                if (!resource_registry_load(optarg)) return 1;
+                break;
+            case 'j': {
+                char* end;
+                long workers = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || workers < 0 || workers > MAX_OPTI_WORKERS) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                if (workers == 0) workers = sysconf(_SC_NPROCESSORS_ONLN);
+                opti_set_workers((unsigned)(workers > 0 ? workers : 1));
+                break;
+            }
+            case 't': {
+                char* end;
+                long threads = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || threads < 0 || threads > MAX_PARSE_THREADS) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                batch_set_threads((unsigned)threads);
+                break;
+            }
+            case 'B':
+                benchmark_file = optarg;
+                break;
+            case 'C':
+                if (strchr(optarg, ':') == NULL) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                compile_arg = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    atexit(stop_scheduler_workers);
+
+    if (benchmark_file != NULL) {
+        return batch_benchmark(benchmark_file) ? 0 : 1;
+    }
+
+    if (compile_arg != NULL) {
+        const char* colon = strrchr(compile_arg, ':');
+        char file[ARG_LEN] = "";
+        if (colon - compile_arg < ARG_LEN) {
+            memcpy(file, compile_arg, (size_t)(colon - compile_arg));
+            file[colon - compile_arg] = '\0';
+        }
+        return compile_batch(file, colon + 1) ? 0 : 1;
+    }
     
 
     Vector* queue = malloc(sizeof(Vector)); 
@@ -35,11 +138,11 @@ int main() {
     printf("The OPTI scheduler may take some time to run, please be patient!\n");
 
     while (true) {
-        Request req = fetch_input();
+        Command cmd = fetch_input();
         
-        switch (req.type) {
+        switch (cmd.type) {
             case BATCH: {
-                bool is_end = process_batch(queue, &req, &invalid_cnt);
+                bool is_end = process_batch(queue, &cmd, &invalid_cnt);
                 printf("-> [Pending]\n");
                 if (!is_end) {
                     break;
@@ -47,24 +150,15 @@ int main() {
                 __attribute__((fallthrough));
             }
             case TERMINATE:
+                stop_scheduler_workers();
                 printf("Bye!");
                 return 0;
-            case PRINT: {
-                const pid_t pid = fork();
-                if (pid < 0) {
-                    perror("fork");
-                    exit(0);
-                } else if (pid == 0) {
-                    schedule_and_print_bookings(req.algo, queue, invalid_cnt);
-                    exit(0);
-                } else {
-                    wait(NULL);
-                    printf("-> [Done]\n");
-                }
+            case PRINT:
+                schedule_and_print_bookings(cmd.algo, cmd.format, cmd.file, queue, invalid_cnt);
+                printf("-> [Done]\n");
                 break;
-            }
             case REQUEST:
-                process_request(queue, &req);
+                process_request(queue, &cmd.request);
                 // Scheduling algorithms will be called in case PRINT. [Revision Mar 25]
                 printf("-> [Pending]\n");
                 break;
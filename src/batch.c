@@ -0,0 +1,470 @@
+//
+// batch.c
+// Reading batch files line by line, in place
+//
+
+#include "batch.h"
+#include "resource.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STREAM_BLOCK (1 << 16)
+
+_Static_assert(STREAM_BLOCK > BATCH_LINE_MAX, "a whole line must fit into a block");
+
+/* PRIVATE METHODS */
+
+static bool open_reader(BatchReader* reader, const char* path, bool may_map) {
+    *reader = (BatchReader){.fd = -1, .pending_eof = true};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (may_map && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            (void)madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            reader->data = map;
+            reader->size = (size_t)st.st_size;
+            reader->mapped = true;
+            reader->at_end = true;
+            return true;
+        }
+    }
+
+    reader->fd = fd;
+    reader->buffer = malloc(STREAM_BLOCK);
+    if (reader->buffer == NULL) {
+        close(fd);
+        return false;
+    }
+    reader->capacity = STREAM_BLOCK;
+    reader->data = reader->buffer;
+    return true;
+}
+
+// Makes sure a whole line from pos on is buffered, unless the input ends first.
+static void fill(BatchReader* reader) {
+    if (reader->at_end || reader->size - reader->pos >= BATCH_LINE_MAX) return;
+
+    size_t rest = reader->size - reader->pos;
+    memmove(reader->buffer, reader->buffer + reader->pos, rest);
+    reader->size = rest;
+    reader->pos = 0;
+    while (reader->size < BATCH_LINE_MAX) {
+        ssize_t n = read(reader->fd, reader->buffer + reader->size, reader->capacity - reader->size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            reader->at_end = true;
+            return;
+        }
+        reader->size += (size_t)n;
+    }
+}
+
+/* PUBLIC METHODS */
+
+bool batch_open(BatchReader* reader, const char* path) {
+    return open_reader(reader, path, true);
+}
+
+bool batch_next_line(BatchReader* reader, StringView* line) {
+    fill(reader);
+    size_t rest = reader->size - reader->pos;
+    if (rest == 0) {
+        if (!reader->pending_eof) return false;
+        reader->pending_eof = false;
+        *line = (StringView){NULL, 0};
+        return true;
+    }
+
+    const char* start = reader->data + reader->pos;
+    size_t max = rest < BATCH_LINE_MAX ? rest : BATCH_LINE_MAX;
+    const char* newline = memchr(start, '\n', max);
+    size_t len = newline ? (size_t)(newline - start) + 1 : max;
+    reader->pos += len;
+    // fgets() only noticed the end of the file when a line ran into it
+    reader->pending_eof = newline != NULL || len == BATCH_LINE_MAX;
+    *line = (StringView){start, len};
+    return true;
+}
+
+void batch_close(BatchReader* reader) {
+    if (reader->mapped) {
+        munmap((void*)reader->data, reader->size);
+    } else {
+        free(reader->buffer);
+        close(reader->fd);
+    }
+    *reader = (BatchReader){.fd = -1};
+}
+
+
+/* COMPILED BATCHES */
+
+// Fletcher-style sums over 32-bit words: a changed, dropped or reordered word changes the result.
+static uint64_t checksum_update(uint64_t sum, const void* data, size_t size) {
+    uint32_t a = (uint32_t)sum, b = (uint32_t)(sum >> 32);
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, bytes + i, 4);
+        a += word;
+        b += a;
+    }
+    return (uint64_t)b << 32 | a;
+}
+
+static uint64_t compiled_checksum(const CompiledBatchHeader* header, const Request* requests) {
+    CompiledBatchHeader copy = *header;
+    copy.checksum = 0;
+    uint64_t sum = checksum_update(0, &copy, sizeof(copy));
+    return checksum_update(sum, requests, (size_t)header->request_cnt * sizeof(Request));
+}
+
+static void fill_header(CompiledBatchHeader* header, int request_cnt, int invalid_cnt, bool ends_program) {
+    *header = (CompiledBatchHeader){
+        .magic = COMPILED_BATCH_MAGIC,
+        .version = COMPILED_BATCH_VERSION,
+        .record_size = sizeof(Request),
+        .request_cnt = (uint32_t)request_cnt,
+        .invalid_cnt = (uint32_t)invalid_cnt,
+        .flags = ends_program ? COMPILED_ENDS_PROGRAM : 0,
+        .registry = resource_registry_fingerprint(),
+        .first_day = horizon_start_day(),
+        .days = horizon_minutes() / (24 * 60),
+    };
+}
+
+// The rules parse_input() applies to a request, since anyone can recompute the checksum: a
+// positive duration ending within the horizon, a member A to E, one of the four priorities, only
+// registered resources, and parking exactly for the requests above bookEssentials (priority 3),
+// which must book some essential instead.
+static bool compiled_record_valid(const Request* req) {
+    ResourceMask registered = resource_count() >= MAX_RESOURCES ? ~(ResourceMask)0
+                                                                : RESOURCE_BIT(resource_count()) - 1;
+    ResourceMask parking = RESOURCE_BIT(resource_parking());
+    if (req->duration == 0 || (int)(req->start + req->duration) > horizon_minutes()) return false;
+    if (req->member < 'A' || req->member > 'E' || req->priority > 3) return false;
+    if ((req->resources & ~registered) != 0) return false;
+    if (req->priority < 3) return (req->resources & parking) != 0;
+    return req->resources != 0 && (req->resources & parking) == 0;
+}
+
+bool batch_is_compiled(BatchReader* reader) {
+    if (!reader->mapped) fill(reader);
+    return reader->size - reader->pos >= sizeof(COMPILED_BATCH_MAGIC) &&
+           memcmp(reader->data + reader->pos, COMPILED_BATCH_MAGIC, sizeof(COMPILED_BATCH_MAGIC)) == 0;
+}
+
+bool batch_load_compiled(const BatchReader* reader, const char* path, Vector* queue, int* invalid_cnt,
+                         bool* ends_program) {
+    if (!reader->mapped) {
+        printf("Error: The compiled batch %s must be a regular file\n", path);
+        return false;
+    }
+    if (reader->size < sizeof(CompiledBatchHeader)) {
+        printf("Error: The compiled batch %s is truncated\n", path);
+        return false;
+    }
+
+    CompiledBatchHeader header;
+    memcpy(&header, reader->data, sizeof(header));
+    if (header.version != COMPILED_BATCH_VERSION || header.record_size != sizeof(Request)) {
+        printf("Error: The compiled batch %s has version %u, expected %u; compile it again\n",
+               path, header.version, COMPILED_BATCH_VERSION);
+        return false;
+    }
+    if (reader->size != sizeof(header) + (size_t)header.request_cnt * sizeof(Request) ||
+        header.request_cnt > (uint32_t)(INT32_MAX - queue->size) || header.invalid_cnt > INT32_MAX) {
+        printf("Error: The compiled batch %s is truncated\n", path);
+        return false;
+    }
+    const Request* requests = (const Request*)(const void*)(reader->data + sizeof(header));
+    if (header.checksum != compiled_checksum(&header, requests)) {
+        printf("Error: The compiled batch %s is damaged (checksum mismatch)\n", path);
+        return false;
+    }
+
+    CompiledBatchHeader expected;
+    fill_header(&expected, 0, 0, false);
+    if (header.registry != expected.registry) {
+        printf("Error: The compiled batch %s was compiled with other resources; compile it again\n", path);
+        return false;
+    }
+    if (header.first_day != expected.first_day || header.days != expected.days) {
+        printf("Error: The compiled batch %s was compiled for another horizon; compile it again\n", path);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.request_cnt; i++) {
+        if (!compiled_record_valid(&requests[i])) {
+            printf("Error: The compiled batch %s has an invalid request (record %u); compile it again\n", path, i);
+            return false;
+        }
+    }
+
+    int first = queue->size, count = (int)header.request_cnt;
+    vector_append(queue, requests, count);
+    for (int i = 0; i < count; i++) queue->data[first + i].order = first + i + 1;
+    *invalid_cnt += (int)header.invalid_cnt;
+    *ends_program = (header.flags & COMPILED_ENDS_PROGRAM) != 0;
+    return true;
+}
+
+bool batch_write_compiled(const char* path, const Request* requests, int request_cnt, int invalid_cnt,
+                          bool ends_program) {
+    Request* records = malloc((size_t)(request_cnt > 0 ? request_cnt : 1) * sizeof(Request));
+    if (records == NULL) exit(1);
+    if (request_cnt > 0) memcpy(records, requests, (size_t)request_cnt * sizeof(Request));
+    for (int i = 0; i < request_cnt; i++) records[i].order = i + 1;
+
+    CompiledBatchHeader header;
+    fill_header(&header, request_cnt, invalid_cnt, ends_program);
+    header.checksum = compiled_checksum(&header, records);
+
+    FILE* fp = fopen(path, "wb");
+    bool ok = fp != NULL &&
+              fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(records, sizeof(Request), (size_t)request_cnt, fp) == (size_t)request_cnt;
+    if (fp != NULL && fclose(fp) != 0) ok = false;
+    free(records);
+    if (!ok) printf("Error: Cannot write the compiled batch %s\n", path);
+    return ok;
+}
+
+
+/* PARALLEL PARSING */
+
+static unsigned parse_threads = 0;
+
+typedef struct ChunkJob {
+    const char* data;
+    size_t size;
+    bool last;          // only the last chunk ends where the file does
+    ParsedChunk* out;
+} ChunkJob;
+
+static void push_barrier(ParsedChunk* chunk, const Command* cmd) {
+    if (chunk->barriers_cnt == chunk->barriers_capacity) {
+        int capacity = chunk->barriers_capacity ? chunk->barriers_capacity * 2 : 4;
+        ChunkBarrier* grown = realloc(chunk->barriers, (size_t)capacity * sizeof(ChunkBarrier));
+        if (grown == NULL) exit(1);
+        chunk->barriers = grown;
+        chunk->barriers_capacity = capacity;
+    }
+    chunk->barriers[chunk->barriers_cnt++] = (ChunkBarrier){
+        .requests = chunk->requests.size,
+        .invalid_cnt = chunk->invalid_cnt,
+        .messages = chunk->messages.size,
+        .cmd = *cmd,
+    };
+}
+
+static void* parse_chunk(void* arg) {
+    const ChunkJob* job = arg;
+    ParsedChunk* out = job->out;
+    parse_set_messages(&out->messages);
+
+    BatchReader slice = {.data = job->data, .size = job->size, .mapped = true, .fd = -1,
+                         .at_end = true, .pending_eof = true};
+    StringView line;
+    while (batch_next_line(&slice, &line)) {
+        if (line.data == NULL) {
+            // the end of the file, which counts as one more invalid line (see batch_next_line())
+            if (job->last) out->invalid_cnt++;
+            continue;
+        }
+        Command cmd = parse_line(line.data, line.len);
+        switch (cmd.type) {
+            case REQUEST:
+                vector_add(&out->requests, cmd.request);
+                break;
+            case INVALID:
+                out->invalid_cnt++;
+                break;
+            default:
+                push_barrier(out, &cmd);
+                break;
+        }
+    }
+
+    parse_set_messages(NULL);
+    return NULL;
+}
+
+void batch_set_threads(unsigned threads) {
+    parse_threads = threads < MAX_PARSE_THREADS ? threads : MAX_PARSE_THREADS;
+}
+
+int batch_parse_parallel(const BatchReader* reader, ParsedChunk** chunks) {
+    unsigned threads = parse_threads;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : cpus > MAX_PARSE_THREADS ? MAX_PARSE_THREADS : (unsigned)cpus;
+    }
+    size_t rest = reader->size - reader->pos;
+    size_t count = rest / PARALLEL_CHUNK_MIN < threads ? rest / PARALLEL_CHUNK_MIN : threads;
+    if (!reader->mapped || count < 2) return 0;
+
+    // chunk c starts at the first line start from c * rest / count on
+    const char* data = reader->data + reader->pos;
+    size_t starts[MAX_PARSE_THREADS + 1];
+    size_t n = 0;
+    starts[n++] = 0;
+    for (size_t c = 1; c < count; c++) {
+        size_t from = c * (rest / count);
+        if (from < starts[n - 1]) continue;
+        const char* newline = memchr(data + from, '\n', rest - from);
+        if (newline == NULL || (size_t)(newline - data) + 1 >= rest) break;
+        starts[n++] = (size_t)(newline - data) + 1;
+    }
+    starts[n] = rest;
+    if (n < 2) return 0;
+
+    // the item index is built on the first lookup; build it before the threads share it
+    (void)resource_lookup("");
+
+    ParsedChunk* out = calloc(n, sizeof(ParsedChunk));
+    ChunkJob jobs[MAX_PARSE_THREADS];
+    pthread_t tids[MAX_PARSE_THREADS];
+    if (out == NULL) exit(1);
+    for (size_t c = 0; c < n; c++) {
+        size_t size = starts[c + 1] - starts[c];
+        vector_init(&out[c].requests);
+        vector_reserve(&out[c].requests, (int)(size / 64) + 1);    // lines are about 50 bytes
+        jobs[c] = (ChunkJob){data + starts[c], size, c + 1 == n, &out[c]};
+    }
+    for (size_t c = 1; c < n; c++) {
+        if (pthread_create(&tids[c], NULL, parse_chunk, &jobs[c]) != 0) exit(1);
+    }
+    parse_chunk(&jobs[0]);
+    for (size_t c = 1; c < n; c++) pthread_join(tids[c], NULL);
+
+    *chunks = out;
+    return (int)n;
+}
+
+void batch_free_chunks(ParsedChunk* chunks, int count) {
+    for (int c = 0; c < count; c++) {
+        vector_free(&chunks[c].requests);
+        message_buffer_free(&chunks[c].messages);
+        free(chunks[c].barriers);
+    }
+    free(chunks);
+}
+
+
+/* BENCHMARK */
+
+// What process_batch() did before the reader: fgets(), strip(), split() and a copy of every token.
+static Command legacy_file_input(FILE* file) {
+    char input[1000];
+    if (fgets(input, 1000, file) == NULL) return (Command){.type = INVALID};
+
+    Command cmd = {.type = INVALID};
+    strip(input);
+    char** result = split(input);
+    char tokens[8][100];
+    for (int i = 0; i < 8 && result[i]; i++) {
+        strncpy(tokens[i], result[i], 99);
+        tokens[i][99] = '\0';
+        free(result[i]);
+    }
+    free(result);
+
+    if (compare(tokens[0], "endProgram")) {
+        cmd.type = TERMINATE;
+        return cmd;
+    }
+    parse_input(tokens, &cmd);
+    return cmd;
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// One pass over the file. Returns the number of lines, or -1 if it cannot be opened.
+static long parse_pass(const char* path, int method, long* requests) {
+    long lines = 0;
+    *requests = 0;
+    if (method == 2) {
+        FILE* fp = fopen(path, "r");
+        if (fp == NULL) return -1;
+        while (!feof(fp)) {
+            lines++;
+            *requests += legacy_file_input(fp).type == REQUEST;
+        }
+        fclose(fp);
+        return lines;
+    }
+
+    BatchReader reader;
+    if (!open_reader(&reader, path, method == 0)) return -1;
+    StringView line;
+    while (batch_next_line(&reader, &line)) {
+        lines++;
+        if (line.data) *requests += parse_line(line.data, line.len).type == REQUEST;
+    }
+    batch_close(&reader);
+    return lines;
+}
+
+bool batch_benchmark(const char* path) {
+    static const char* names[3] = {"mmap", "streaming", "stdio + split"};
+    const double min_seconds = 0.5;
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: %s is not a regular file, which every reader can read again\n", path);
+        return false;
+    }
+
+    // the parser reports every invalid line on stdout
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || null_fd < 0) return false;
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    bool ok = true;
+    for (int method = 0; method < 3 && ok; method++) {
+        long lines = 0, requests = 0, rounds = 0;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        double elapsed;
+        do {
+            lines = parse_pass(path, method, &requests);
+            rounds++;
+            elapsed = seconds_since(&start);
+        } while (lines >= 0 && elapsed < min_seconds);
+
+        fflush(stdout);
+        if (lines < 0) {
+            fprintf(stderr, "Error: Cannot open the batch file %s\n", path);
+            ok = false;
+            break;
+        }
+        fprintf(stderr, "%-14s %ld lines (%ld requests) x %ld rounds in %.3f s: %.0f lines/s\n",
+                names[method], lines, requests, rounds, elapsed, (double)(lines * rounds) / elapsed);
+    }
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    return ok;
+}
@@ -0,0 +1,171 @@
+//
+// batch.h
+// Reading batch files line by line, in place
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "input.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest line handed out at once. Longer lines come in pieces of this length, as they did from
+// fgets() with the 1000-byte buffer the console still uses.
+#define BATCH_LINE_MAX 999
+
+// Reads the lines of a batch file without copying them. Regular files are mapped into memory;
+// anything that cannot be mapped (pipes, FIFOs, terminals) is read in large blocks instead.
+typedef struct BatchReader {
+    const char* data;   // the mapping, or the block buffer
+    size_t size;        // bytes of data available
+    size_t pos;         // start of the next line
+    bool mapped;
+    int fd;             // streaming only, -1 when mapped
+    char* buffer;
+    size_t capacity;
+    bool at_end;        // no more bytes to read into data
+    bool pending_eof;   // see batch_next_line()
+} BatchReader;
+
+/**
+ * Opens a batch file
+ * @return false if the file cannot be opened
+ */
+bool batch_open(BatchReader* reader, const char* path);
+
+/**
+ * Hands out the next line, including its '\n', which stays valid until the next call.
+ * Like the fgets() loop it replaces, a file that is empty or ends with a '\n' ends with one more
+ * line, whose data is NULL
+ * @return false at the end of the file
+ */
+bool batch_next_line(BatchReader* reader, StringView* line);
+
+void batch_close(BatchReader* reader);
+
+
+/* COMPILED BATCHES */
+
+// A compiled batch is this header, followed by request_cnt Request records as the queue holds them,
+// in the byte order and bit-field layout of the build that wrote it.
+#define COMPILED_BATCH_MAGIC    "SPMSbat"   // with its '\0', 8 bytes
+#define COMPILED_BATCH_VERSION  1u
+
+#define COMPILED_ENDS_PROGRAM   1u          // the text batch stopped at an endProgram
+
+/**
+ * @param magic         COMPILED_BATCH_MAGIC
+ * @param version       COMPILED_BATCH_VERSION
+ * @param record_size   sizeof(Request)
+ * @param request_cnt   Number of records
+ * @param invalid_cnt   Invalid lines of the text batch, including those of nested batches
+ * @param flags         COMPILED_ENDS_PROGRAM or 0
+ * @param registry      resource_registry_fingerprint() when compiled, since records hold resource bits
+ * @param first_day     horizon_start_day() when compiled, since records hold minutes since then
+ * @param days          Days of the horizon when compiled
+ * @param checksum      Of the header, with this field 0, and the records
+ */
+typedef struct CompiledBatchHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t request_cnt;
+    uint32_t invalid_cnt;
+    uint32_t flags;
+    uint32_t registry;
+    int32_t first_day;
+    int32_t days;
+    uint64_t checksum;
+} CompiledBatchHeader;
+
+_Static_assert(sizeof(CompiledBatchHeader) == 48, "the records must stay aligned after the header");
+
+/**
+ * @return true if an opened batch file, from which no line was read yet, is a compiled batch
+ */
+bool batch_is_compiled(BatchReader* reader);
+
+/**
+ * Appends the requests of an opened compiled batch to the queue, numbering them after the requests
+ * already in it, and adds its invalid lines to invalid_cnt
+ * @param ends_program  set to whether the text batch stopped at an endProgram
+ * @return false, printing the reason and changing nothing, if the file is damaged, was not mapped,
+ * was compiled with another resource registry, horizon or version, or holds a request the text
+ * parser would have rejected
+ */
+bool batch_load_compiled(const BatchReader* reader, const char* path, Vector* queue, int* invalid_cnt,
+                         bool* ends_program);
+
+/**
+ * Writes requests, numbered from 1, to a compiled batch
+ * @return false, printing the reason, if the file cannot be written
+ */
+bool batch_write_compiled(const char* path, const Request* requests, int request_cnt, int invalid_cnt,
+                          bool ends_program);
+
+/* PARALLEL PARSING */
+
+// Mapped batch files are parsed by several threads, in chunks of at least this many bytes.
+#define PARALLEL_CHUNK_MIN  (256 << 10)
+#define MAX_PARSE_THREADS   64
+
+/**
+ * A line whose effect depends on everything before it, so it is only run once the chunks before it
+ * are added to the queue: addBatch, printBookings or endProgram.
+ *
+ * @param requests      Requests of its chunk before it
+ * @param invalid_cnt   Invalid lines of its chunk before it
+ * @param messages      Bytes of parser messages of its chunk before it
+ * @param cmd           The line, parsed
+ */
+typedef struct ChunkBarrier {
+    int requests;
+    int invalid_cnt;
+    size_t messages;
+    Command cmd;
+} ChunkBarrier;
+
+/**
+ * What one thread parsed of a chunk of lines.
+ *
+ * @param requests      The requests, in file order, not numbered yet
+ * @param invalid_cnt   Number of invalid lines
+ * @param messages      What the parser would have printed about them
+ * @param barriers      The barrier lines, in file order
+ */
+typedef struct ParsedChunk {
+    Vector requests;
+    int invalid_cnt;
+    MessageBuffer messages;
+    ChunkBarrier* barriers;
+    int barriers_cnt;
+    int barriers_capacity;
+} ParsedChunk;
+
+/**
+ * Sets how many threads parse a batch file, 0 for one per online CPU (the default)
+ */
+void batch_set_threads(unsigned threads);
+
+/**
+ * Splits an opened batch file, from which no line was read yet, into chunks at line starts and
+ * parses them in parallel, one thread per chunk. Lines come out as batch_next_line() cuts them.
+ * @return the number of chunks, or 0 (and nothing in chunks) if the file is not mapped, too small
+ * for two chunks, or only one thread may parse it
+ */
+int batch_parse_parallel(const BatchReader* reader, ParsedChunk** chunks);
+void batch_free_chunks(ParsedChunk* chunks, int count);
+
+
+/**
+ * Parses every line of a batch file with the mapped reader, the streaming reader and the old
+ * stdio path, and reports the throughput of each on stderr. Nothing is added to any queue.
+ * @return false if path is not a regular file or cannot be opened
+ */
+bool batch_benchmark(const char* path);
+
+#endif //BATCH_H
@@ -0,0 +1,182 @@
+#include "counttree.h"
+#include "daypages.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+// One day of counts.
+// tree[p] is the maximum of the subtree of p, including every pending add of p and its descendants.
+// add[p] (internal nodes 1 .. size - 1 only) is added to the whole range of p and is not yet
+// included in its children, so tree[p] = max(tree[2p], tree[2p + 1]) + add[p].
+// Leaves beyond the page are padding and stay 0 forever.
+typedef struct CountPage {
+    int start;      // first position of the page
+    unsigned size;  // number of leaves, rounded up to a power of two
+    unsigned h;     // log2(size)
+    int* tree;      // 2 * size nodes, then size pending adds
+    int* add;
+} CountPage;
+
+struct CountTree {
+    unsigned capacity;
+    DayPages days;  // of CountPages
+};
+
+/* PRIVATE METHODS */
+
+static void apply(CountPage* pg, unsigned p, int delta) {
+    pg->tree[p] += delta;
+    if (p < pg->size) pg->add[p] += delta;
+}
+
+// Recomputes the path from node p up to the root.
+static void pull(CountPage* pg, unsigned p) {
+    while (p > 1) {
+        p >>= 1;
+        int left = pg->tree[p * 2], right = pg->tree[p * 2 + 1];
+        pg->tree[p] = ((left > right) ? left : right) + pg->add[p];
+    }
+}
+
+// Pushes pending adds down along the path from the root to node p (exclusive).
+static void push(CountPage* pg, unsigned p) {
+    for (unsigned s = pg->h; s > 0; s--) {
+        unsigned i = p >> s;
+        if (pg->add[i] != 0) {
+            apply(pg, i * 2, pg->add[i]);
+            apply(pg, i * 2 + 1, pg->add[i]);
+            pg->add[i] = 0;
+        }
+    }
+}
+
+static void page_add(CountPage* pg, int l, int r, int delta) {
+    unsigned lo = (unsigned)(l - pg->start) + pg->size;
+    unsigned hi = (unsigned)(r - pg->start) + pg->size + 1;  // half-open
+    for (unsigned a = lo, b = hi; a < b; a >>= 1, b >>= 1) {
+        if (a & 1) apply(pg, a++, delta);
+        if (b & 1) apply(pg, --b, delta);
+    }
+    pull(pg, lo);
+    pull(pg, hi - 1);
+}
+
+static int page_max(CountPage* pg, int l, int r) {
+    unsigned lo = (unsigned)(l - pg->start) + pg->size;
+    unsigned hi = (unsigned)(r - pg->start) + pg->size + 1;  // half-open
+    push(pg, lo);
+    push(pg, hi - 1);
+    int res = INT_MIN;
+    for (unsigned a = lo, b = hi; a < b; a >>= 1, b >>= 1) {
+        if (a & 1) {
+            res = (pg->tree[a] > res) ? pg->tree[a] : res;
+            a++;
+        }
+        if (b & 1) {
+            --b;
+            res = (pg->tree[b] > res) ? pg->tree[b] : res;
+        }
+    }
+    return res;
+}
+
+static void* page_build(int start, int end, unsigned arg) {
+    (void)arg;
+    CountPage* pg = malloc(sizeof(CountPage));
+    if (pg == NULL) return NULL;
+    pg->start = start;
+    pg->size = 1;
+    pg->h = 0;
+    while (pg->size < (unsigned)(end - start + 1)) pg->size <<= 1, pg->h++;
+    pg->tree = calloc((size_t)pg->size * 3, sizeof(int));
+    if (pg->tree == NULL) {
+        free(pg);
+        return NULL;
+    }
+    pg->add = pg->tree + (size_t)pg->size * 2;
+    return pg;
+}
+
+static void page_destroy(void* payload) {
+    CountPage* pg = payload;
+    free(pg->tree);
+    free(pg);
+}
+
+static void page_overwrite(void* source, void* target) {
+    const CountPage* from = source;
+    CountPage* to = target;
+    assert(from->size == to->size);
+    memcpy(to->tree, from->tree, (size_t)from->size * 3 * sizeof(int));
+}
+
+static const DayPageOps count_pages = {
+    .build = page_build,
+    .destroy = page_destroy,
+    .overwrite = page_overwrite,
+};
+
+/* PUBLIC METHODS */
+
+CountTree* counttree_build(int start, int end, unsigned capacity) {
+    CountTree* ct = (CountTree*)malloc(sizeof(CountTree));
+    if (ct == NULL) return NULL;
+    ct->capacity = capacity;
+    if (!daypages_init(&ct->days, start, end, 0, &count_pages)) {
+        free(ct);
+        return NULL;
+    }
+    return ct;
+}
+
+void counttree_destroy(CountTree* ct) {
+    if (ct == NULL) return;
+    daypages_free(&ct->days);
+    free(ct);
+}
+
+void counttree_empty(CountTree* ct) {
+    daypages_empty(&ct->days);
+}
+
+void counttree_range_add(CountTree* ct, int l, int r, int delta) {
+    DayPages* days = &ct->days;
+    assert(days->start <= l && l <= r && r <= days->end);
+    for (unsigned i = daypages_of(days, l); i <= daypages_of(days, r); i++) {
+        assert(delta > 0 || daypages_get(days, i) != NULL);
+        int lo = daypages_start(days, i), hi = daypages_end(days, i);
+        CountPage* pg = daypages_writable(days, i);
+        page_add(pg, l > lo ? l : lo, r < hi ? r : hi, delta);
+        assert(pg->tree[1] <= (int)ct->capacity);
+    }
+}
+
+int counttree_range_max(CountTree* ct, int l, int r) {
+    const DayPages* days = &ct->days;
+    assert(days->start <= l && l <= r && r <= days->end);
+    int res = 0;
+    for (unsigned i = daypages_of(days, l); i <= daypages_of(days, r); i++) {
+        CountPage* pg = daypages_get(days, i);
+        if (pg == NULL) continue;
+        int lo = daypages_start(days, i), hi = daypages_end(days, i);
+        int busy = page_max(pg, l > lo ? l : lo, r < hi ? r : hi);
+        res = (busy > res) ? busy : res;
+    }
+    return res;
+}
+
+unsigned counttree_capacity(const CountTree* ct) {
+    return ct->capacity;
+}
+
+int counttree_first_free(CountTree* ct, int l, int r) {
+    int busy = counttree_range_max(ct, l, r);
+    return (busy + 1 <= (int)ct->capacity) ? busy : -1;
+}
+
+void counttree_overwrite(CountTree* source, CountTree* target) {
+    assert(source && target);
+    target->capacity = source->capacity;
+    daypages_share(&source->days, &target->days);
+}
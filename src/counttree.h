@@ -0,0 +1,73 @@
+#ifndef COUNTTREE_H
+#define COUNTTREE_H
+
+/**
+ * Opaque handle representing the number of busy slots at every position of [start, end],
+ * for a resource with `capacity` interchangeable slots.
+ * It is a segment tree with range-add and range-max, so an admission check costs O(log n)
+ * no matter how many slots there are. It does not know which slot is busy;
+ * use assign_slots() (utils.h) to number the bookings afterwards.
+ * The tree is split into day pages (daypages.h) that are only allocated when first booked and
+ * are shared between copies until one of them writes, so long horizons stay cheap.
+ */
+typedef struct CountTree CountTree;
+
+/**
+ * Creates a tree over [start, end] where no slot is busy. Allocates no pages.
+ *
+ * @param start     Start index (inclusive)
+ * @param end       End index (inclusive)
+ * @param capacity  Number of slots
+ * @return          New handle. Must be destroyed with counttree_destroy(). NULL on allocation failure
+ */
+CountTree* counttree_build(int start, int end, unsigned capacity);
+
+/**
+ * Safely destroys the tree and releases all resources
+ *
+ * @param ct        Handle from counttree_build(). No-op if NULL
+ */
+void counttree_destroy(CountTree* ct);
+
+/**
+ * Marks every slot free again by dropping every page
+ * @param ct        Pointer to the tree to be emptied
+ */
+void counttree_empty(CountTree* ct);
+
+/**
+ * Adds delta busy slots at every position of [l, r]
+ *
+ * @param ct        Handle from counttree_build()
+ * @param l         Left range boundary (inclusive)
+ * @param r         Right range boundary (inclusive)
+ * @param delta     +1 books a slot, -1 releases one. Counts must stay within [0, capacity]
+ */
+void counttree_range_add(CountTree* ct, int l, int r, int delta);
+
+/**
+ * @return          The largest number of busy slots at any position of [l, r]
+ */
+int counttree_range_max(CountTree* ct, int l, int r);
+
+/**
+ * @return          Number of slots given to counttree_build()
+ */
+unsigned counttree_capacity(const CountTree* ct);
+
+/**
+ * A booking of [l, r] fits iff counttree_range_max(l, r) + 1 <= capacity.
+ *
+ * @return          counttree_range_max(l, r) if the booking fits, -1 otherwise
+ */
+int counttree_first_free(CountTree* ct, int l, int r);
+
+/**
+ * Makes target share every page of source. O(number of pages), no page is copied.
+ *
+ * @param source    Source tree to copy from
+ * @param target    Target tree to copy to
+ */
+void counttree_overwrite(CountTree* source, CountTree* target);
+
+#endif // COUNTTREE_H
@@ -0,0 +1,78 @@
+#include "daypages.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+/* PRIVATE METHODS */
+
+static void release(const DayPages* dp, DayPage* page) {
+    if (page == NULL || --page->refs > 0) return;
+    dp->ops->destroy(page->payload);
+    free(page);
+}
+
+/* PUBLIC METHODS */
+
+bool daypages_init(DayPages* dp, int start, int end, unsigned arg, const DayPageOps* ops) {
+    assert(end - start + 1 > 0);
+    dp->start = start;
+    dp->end = end;
+    dp->arg = arg;
+    dp->ops = ops;
+    dp->n_pages = (unsigned)((end - start) / DAY_PAGE_LEN + 1);
+    dp->pages = calloc(dp->n_pages, sizeof(DayPage*));
+    return dp->pages != NULL;
+}
+
+void daypages_free(DayPages* dp) {
+    daypages_empty(dp);
+    free(dp->pages);
+    dp->pages = NULL;
+    dp->n_pages = 0;
+}
+
+void daypages_empty(DayPages* dp) {
+    for (unsigned i = 0; i < dp->n_pages; i++) {
+        release(dp, dp->pages[i]);
+        dp->pages[i] = NULL;
+    }
+}
+
+void* daypages_writable(DayPages* dp, unsigned i) {
+    DayPage* page = dp->pages[i];
+    if (page != NULL && page->refs == 1) return page->payload;
+
+    DayPage* fresh = malloc(sizeof(DayPage));
+    assert(fresh != NULL);
+    fresh->refs = 1;
+    fresh->payload = dp->ops->build(daypages_start(dp, i), daypages_end(dp, i), dp->arg);
+    assert(fresh->payload != NULL);
+    if (page != NULL) {
+        dp->ops->overwrite(page->payload, fresh->payload);
+        release(dp, page);
+    }
+    dp->pages[i] = fresh;
+    return fresh->payload;
+}
+
+void daypages_share(DayPages* source, DayPages* target) {
+    assert(source->ops == target->ops && source->arg == target->arg);
+    if (target->n_pages != source->n_pages) {
+        daypages_empty(target);
+        DayPage** pages = realloc(target->pages, source->n_pages * sizeof(DayPage*));
+        assert(pages != NULL);
+        memset(pages, 0, source->n_pages * sizeof(DayPage*));
+        target->pages = pages;
+        target->n_pages = source->n_pages;
+    }
+    target->start = source->start;
+    target->end = source->end;
+
+    for (unsigned i = 0; i < source->n_pages; i++) {
+        DayPage* page = source->pages[i];
+        if (target->pages[i] == page) continue;
+        if (page != NULL) page->refs++;
+        release(target, target->pages[i]);
+        target->pages[i] = page;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef DAYPAGES_H
+#define DAYPAGES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DAY_PAGE_LEN    1440    // one day of minutes
+
+/**
+ * How a DayPages container builds, frees and copies the payload of one page.
+ * arg is the value given to daypages_init(), e.g. the number of parallel instances.
+ */
+typedef struct DayPageOps {
+    void* (*build)(int start, int end, unsigned arg);   // an all-zero payload over [start, end]
+    void (*destroy)(void* payload);
+    void (*overwrite)(void* source, void* target);      // both over the same page
+} DayPageOps;
+
+// A day of payload. Shared by every DayPages that points to it.
+typedef struct DayPage {
+    unsigned refs;
+    void* payload;
+} DayPage;
+
+/**
+ * The positions [start, end] split into day-sized pages, each of which holds a payload that is only
+ * built when the page is first written, so an empty day costs a NULL pointer. Pages are reference
+ * counted: daypages_share() shares them instead of copying, and a shared page is copied by whichever
+ * side writes it first. PagedTree and CountTree keep their days in one.
+ */
+typedef struct DayPages {
+    int start;
+    int end;
+    unsigned arg;
+    unsigned n_pages;
+    const DayPageOps* ops;
+    DayPage** pages;    // pages[i] covers [start + i * DAY_PAGE_LEN, start + (i + 1) * DAY_PAGE_LEN), NULL if all zero
+} DayPages;
+
+/**
+ * Initializes dp over [start, end] with no page built
+ *
+ * @param start     Start index (inclusive)
+ * @param end       End index (inclusive)
+ * @param arg       Passed to ops->build() for every page
+ * @param ops       Payload operations, must outlive dp
+ * @return          false on allocation failure. Otherwise dp must be freed with daypages_free()
+ */
+bool daypages_init(DayPages* dp, int start, int end, unsigned arg, const DayPageOps* ops);
+
+/**
+ * Drops the references of dp to all pages and frees it
+ */
+void daypages_free(DayPages* dp);
+
+/**
+ * Drops every page, so that the whole range reads as zero again
+ */
+void daypages_empty(DayPages* dp);
+
+/**
+ * @return          The payload of page i, building it if absent and copying it if someone else shares it
+ */
+void* daypages_writable(DayPages* dp, unsigned i);
+
+/**
+ * Makes target share every page of source. O(number of pages), no page is copied.
+ *
+ * @param source    Source pages, built with the same ops and arg as target
+ * @param target    Target pages to overwrite
+ */
+void daypages_share(DayPages* source, DayPages* target);
+
+/**
+ * @return          The payload of page i for reading, NULL if the page was never written
+ */
+static inline void* daypages_get(const DayPages* dp, unsigned i) {
+    return dp->pages[i] ? dp->pages[i]->payload : NULL;
+}
+
+/**
+ * @return          The page holding position x
+ */
+static inline unsigned daypages_of(const DayPages* dp, int x) {
+    return (unsigned)((x - dp->start) / DAY_PAGE_LEN);
+}
+
+/**
+ * @return          First position of page i
+ */
+static inline int daypages_start(const DayPages* dp, unsigned i) {
+    return dp->start + (int)i * DAY_PAGE_LEN;
+}
+
+/**
+ * @return          Last position of page i, which is end for the last page
+ */
+static inline int daypages_end(const DayPages* dp, unsigned i) {
+    int end = daypages_start(dp, i) + DAY_PAGE_LEN - 1;
+    return end < dp->end ? end : dp->end;
+}
+
+#endif // DAYPAGES_H
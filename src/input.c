@@ -6,248 +6,361 @@
 #include "utils.h"
 #include "input.h"
 
+#include <ctype.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
-Request fetch_input() {
+// Where this thread's parser reports invalid lines, NULL for stdout.
+static _Thread_local MessageBuffer* messages = NULL;
+
+Command fetch_input() {
     char input[1000];
     printf("Please enter booking:\n");
-    fgets(input, 1000, stdin); // because gets() is unsafe apparently
+    if (fgets(input, 1000, stdin) == NULL) { // because gets() is unsafe apparently
+        return (Command){.type = TERMINATE}; // end of input ends the program like endProgram
+    }
     return preprocess_input(input);
 }
 
-Request file_input(FILE* file) {
+Command file_input(FILE* file) {
     char input[1000];
     if (fgets(input, 1000, file) != NULL) {
         //printf("Preprocessing: [[%s]]\n", input);
         return preprocess_input(input);
     }
-    return (Request){INVALID, 0, 0, 0, 0, 0, 0, 0, NULL, NULL}; // or use {.type = INVALID} in C99 and later.
+    return (Command){.type = INVALID};
+}
+
+Command preprocess_input(const char* input) {
+    return parse_line(input, strlen(input));
 }
 
-Request preprocess_input(char* input) {
-    Request req = {INVALID, 0, 0, 0, 0, 0, 0, 0, NULL, NULL}; // or use {.type = INVALID} in C99 and later.
+void parse_set_messages(MessageBuffer* buffer) {
+    messages = buffer;
+}
+
+void message_buffer_free(MessageBuffer* buffer) {
+    free(buffer->data);
+    *buffer = (MessageBuffer){0};
+}
 
-    strip(input);
+static void report(const char* format, ...) __attribute__((format(printf, 1, 2)));
 
-    char **result = split(input);
+static void report(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (messages == NULL) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
 
-    char tokens[8][100];
-    for (int i = 0; i < 8 && result[i]; i++) {
-        strncpy(tokens[i], result[i], 99);
-        tokens[i][99] = '\0';
-        free(result[i]);
+    va_list again;
+    va_copy(again, args);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len > 0) {
+        size_t need = messages->size + (size_t)len + 1;
+        if (need > messages->capacity) {
+            size_t capacity = messages->capacity ? messages->capacity : 256;
+            while (capacity < need) capacity *= 2;
+            char* grown = realloc(messages->data, capacity);
+            if (grown == NULL) exit(1);
+            messages->data = grown;
+            messages->capacity = capacity;
+        }
+        vsnprintf(messages->data + messages->size, (size_t)len + 1, format, again);
+        messages->size += (size_t)len;
     }
-    free(result);
+    va_end(again);
+}
 
-    if (compare(tokens[0], "endProgram")) {
-        req.type = TERMINATE;
-        return req;
+// The commands, each in the slot hash_lowercase(name, COMMAND_SEED) % COMMAND_SLOTS, which no
+// other command hashes to. COMMAND_SEED is the first seed that separates all of them.
+#define COMMAND_SEED    5u
+#define COMMAND_SLOTS   16
+#define MAX_TOKENS      8
+
+typedef enum Keyword {
+    KW_NONE,
+    KW_END_PROGRAM,
+    KW_ADD_BATCH,
+    KW_PRINT_BOOKINGS,
+    KW_ADD_PARKING,
+    KW_ADD_RESERVATION,
+    KW_ADD_EVENT,
+    KW_BOOK_ESSENTIALS
+} Keyword;
+
+typedef struct CommandEntry {
+    const char* name;   // lowercase
+    Keyword keyword;
+    int priority;       // Event > Reservation > Parking > Essentials, smaller is higher
+} CommandEntry;
+
+static const CommandEntry commands[COMMAND_SLOTS] = {
+    [1]  = {"addevent",       KW_ADD_EVENT,       0},
+    [3]  = {"addreservation", KW_ADD_RESERVATION, 1},
+    [5]  = {"addbatch",       KW_ADD_BATCH,       4},
+    [7]  = {"printbookings",  KW_PRINT_BOOKINGS,  4},
+    [8]  = {"bookessentials", KW_BOOK_ESSENTIALS, 3},
+    [9]  = {"addparking",     KW_ADD_PARKING,     2},
+    [11] = {"endprogram",     KW_END_PROGRAM,     4},
+};
+
+static const CommandEntry* lookup_command(StringView name) {
+    static const CommandEntry unknown = {"", KW_NONE, 4};
+    const CommandEntry* entry = &commands[hash_lowercase(name.data, name.len, COMMAND_SEED) % COMMAND_SLOTS];
+    if (entry->name == NULL || !equals_lowercase(name.data, name.len, entry->name)) return &unknown;
+    return entry;
+}
+
+// Cuts a line into views the way strip() and split() cut it: every ' ' ends a token, and a token
+// ends early at a '\0' or after 99 characters. Missing tokens are empty.
+static void tokenize(const char* line, size_t len, StringView tokens[MAX_TOKENS]) {
+    while (len > 0 && (isspace(line[len - 1]) || line[len - 1] == ';')) len--;
+
+    int t = 0;
+    bool open = true;   // no '\0' in the token yet
+    tokens[0] = (StringView){line, 0};
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] == ' ') {
+            if (++t == MAX_TOKENS) return;
+            tokens[t] = (StringView){line + i + 1, 0};
+            open = true;
+            continue;
+        }
+        if (line[i] == '\0') open = false;
+        if (open && tokens[t].len < ARG_LEN - 1) tokens[t].len++;
     }
+    while (++t < MAX_TOKENS) tokens[t] = (StringView){line, 0};
+}
 
-    parse_input(tokens, &req);
-    return req;
+// token without its first character (the '-'), NUL-terminated into arg
+static void copy_argument(StringView token, char arg[ARG_LEN]) {
+    size_t len = token.len > 0 ? token.len - 1 : 0;
+    if (len > 0) memcpy(arg, token.data + 1, len);
+    arg[len] = '\0';
 }
 
+static void parse_tokens(const StringView tokens[MAX_TOKENS], Command* cmd);
+
+Command parse_line(const char* line, size_t len) {
+    Command cmd = {.type = INVALID};
 
-void parse_input(const char tokens[8][100], Request* req) {
-    const char* type = tokens[0];
+    StringView tokens[MAX_TOKENS];
+    tokenize(line, len, tokens);
+    parse_tokens(tokens, &cmd);
+    return cmd;
+}
+
+void parse_input(const char tokens[8][100], Command* cmd) {
+    StringView views[MAX_TOKENS];
+    for (int i = 0; i < MAX_TOKENS; i++) views[i] = (StringView){tokens[i], strlen(tokens[i])};
+    parse_tokens(views, cmd);
+}
+
+static void parse_tokens(const StringView tokens[MAX_TOKENS], Command* cmd) {
+    const CommandEntry* command = lookup_command(tokens[0]);
+    Request* req = &cmd->request;
 
     // special requests
-    if (compare(type, "addBatch")) {
-        // addBatch -xxxxx  
-        // e.g. addBatch –batch001.dat 
-        req->type = BATCH;
-        req->file = malloc(sizeof(char) * 100);
-        strcpy(req->file, tokens[1] + 1); // + 1 to skip the '-'
+    if (command->keyword == KW_END_PROGRAM) {
+        cmd->type = TERMINATE;
+        return;
+    }
+
+    if (command->keyword == KW_ADD_BATCH) {
+        // addBatch -xxxxx [-yyyyy]
+        // e.g. addBatch –batch001.dat, or addBatch –batch001.dat –batch001.bin to also compile it
+        cmd->type = BATCH;
+        copy_argument(tokens[1], cmd->file); // skip the '-'
+        copy_argument(tokens[2], cmd->compiled);
         return;
     }
 
-    if (compare("printBookings", type)) {
-        // printBookings –xxx –[fcfs/prio/opti/ALL]
-        req->type = PRINT;
-        req->algo = malloc(sizeof(char) * 5);
-        strcpy(req->algo, tokens[1] + 1); // + 1 to skip the '-'
+    if (command->keyword == KW_PRINT_BOOKINGS) {
+        // printBookings –xxx –[fcfs/prio/opti/ALL] [–[table/csv/ndjson/binary/summary] [–file]]
+        cmd->type = PRINT;
+        copy_argument(tokens[1], cmd->algo); // skip the '-'
+        copy_argument(tokens[2], cmd->format);
+        copy_argument(tokens[3], cmd->file);
         return;
     }
 
     // priority: Event > Reservation > Parking > Essentials
     // use convention: priority value smaller is higher priority
-    req->priority = get_priority(type);
-    req->type = REQUEST;
+    req->priority = (unsigned)command->priority & 7u;
+    cmd->type = REQUEST;
 
     char member = parse_member(tokens[1]); // member = 'A', 'B', 'C' ...
     int start = parse_time(tokens[2], tokens[3]); // YYYY-MM-DD, hh:mm
     int duration = parse_duration(tokens[4]); // n.n
 
     if (member == 0) {
-        req->type = INVALID;
-        printf("Invalid Member: %s\n", tokens[1]);
+        cmd->type = INVALID;
+        report("Invalid Member: %.*s\n", (int)tokens[1].len, tokens[1].data);
         return;
     }
 
     if (start == -1) {
-        req->type = INVALID;
-        printf("Invalid Time: %s %s\n", tokens[2], tokens[3]);
+        cmd->type = INVALID;
+        report("Invalid Time: %.*s %.*s\n", (int)tokens[2].len, tokens[2].data, (int)tokens[3].len, tokens[3].data);
         return;
     }
 
     if (duration == -1) {
-        req->type = INVALID;
-        printf("Invalid Duration: %s\n", tokens[4]);
+        cmd->type = INVALID;
+        report("Invalid Duration: %.*s\n", (int)tokens[4].len, tokens[4].data);
         return; 
     }
 
-    if (start + duration - 1 > parse_time("2025-05-16", "23:59")) {
-        req->type = INVALID;
-        printf("Invalid Time: %s %s + duration=%s exceeds 2025-05-16 23:59\n", tokens[2], tokens[3], tokens[4]);
+    if (start + duration - 1 > horizon_minutes() - 1) {
+        char last_date[DATE_STRING_LEN];
+        format_date(horizon_minutes() - 1, last_date);
+        cmd->type = INVALID;
+        report("Invalid Time: %.*s %.*s + duration=%.*s exceeds %s 23:59\n",
+               (int)tokens[2].len, tokens[2].data, (int)tokens[3].len, tokens[3].data,
+               (int)tokens[4].len, tokens[4].data, last_date);
         return;
     }
 
-    req->member = member;
-    req->start = start;
-    req->duration = duration;
+    req->member = (unsigned char)member;
+    req->start = (unsigned)start & REQUEST_TIME_MASK;
+    req->duration = (unsigned)duration & REQUEST_TIME_MASK;
 
 
-    if (compare(type, "addParking")) {
+    if (command->keyword == KW_ADD_PARKING) {
         // addParking -aaa YYYY-MM-DD hh:mm n.n bbb ccc; (bbb, ccc are optional "essential items", but must be paired)
         // parking + essentials (optional)
-        const char* bbb = tokens[5];
-        const char* ccc = tokens[6];
+        StringView bbb = tokens[5];
+        StringView ccc = tokens[6];
 
-        int essentials_cnt = (bool)(strlen(bbb)) + (bool)(strlen(ccc)); // how many essentials parameter
+        int essentials_cnt = (bbb.len > 0) + (ccc.len > 0); // how many essentials parameter
 
         /* deprecated for old latern version
         if (essentials_cnt && get_valid_pair(bbb) == NULL) {
-            req->type = INVALID;
-            printf("[addParking] Invalid Essential Item: %s\n", bbb);
+            cmd->type = INVALID;
+            report("[addParking] Invalid Essential Item: %s\n", bbb);
             return;
         }
 
         if (essentials_cnt == 2 && !is_valid_essentials_pair(bbb, ccc)) {
-            req->type = INVALID;
-            printf("[addParking] Invalid Essentials Pair: %s %s\n", bbb, ccc);
+            cmd->type = INVALID;
+            report("[addParking] Invalid Essentials Pair: %s %s\n", bbb, ccc);
             return;
         }
         */
 
         if (essentials_cnt >= 1) {
             if (!is_valid_essentials(bbb)) {
-                req->type = INVALID;
-                printf("[addParking] Invalid Essential Item: %s (len = %d)\n", bbb, (int)strlen(bbb));
+                cmd->type = INVALID;
+                report("[addParking] Invalid Essential Item: %.*s (len = %d)\n", (int)bbb.len, bbb.data, (int)bbb.len);
                 return;
             }
         }
 
         if (essentials_cnt == 2) {
             if (!is_valid_essentials(ccc)) {
-                req->type = INVALID;
-                printf("[addParking] Invalid Essential Item: %s (len = %d)\n", ccc, (int)strlen(ccc));
+                cmd->type = INVALID;
+                report("[addParking] Invalid Essential Item: %.*s (len = %d)\n", (int)ccc.len, ccc.data, (int)ccc.len);
                 return;
             }
         }
 
 
-        req->parking = true;
-        req->essential = 0;
-        add_essential_value(&(req->essential), bbb);
-        add_essential_value(&(req->essential), ccc);
+        req->resources = RESOURCE_BIT(resource_parking());
+        add_essential_value(&(req->resources), bbb);
+        add_essential_value(&(req->resources), ccc);
         return;
     }
     
-    if (compare(type, "addReservation")) {
+    if (command->keyword == KW_ADD_RESERVATION) {
         // addReservation -aaa YYYY-MM-DD hh:mm n.n bbb ccc; (bbb, ccc are mandatorily included, must be paired)
         // parking + essentials (mandatory)
-        const char* bbb = tokens[5];
-        const char* ccc = tokens[6];
+        StringView bbb = tokens[5];
+        StringView ccc = tokens[6];
         
-        int essentials_cnt = (bool)(strlen(bbb)) + (bool)(strlen(ccc));
+        int essentials_cnt = (bbb.len > 0) + (ccc.len > 0);
 
         /* deprecated for old latern version
         if (essentials_cnt != 2) {
-            req->type = INVALID;
-            printf("[addReservation] Invalid Number of Essentials: Received %d arguments, expected 2\n", essentials_cnt);
+            cmd->type = INVALID;
+            report("[addReservation] Invalid Number of Essentials: Received %d arguments, expected 2\n", essentials_cnt);
             return;
         }
 
         if (!is_valid_essentials_pair(bbb, ccc)) {
-            req->type = INVALID;
-            printf("[addReservation] Invalid Essentials Pair: %s %s\n", bbb, ccc);
+            cmd->type = INVALID;
+            report("[addReservation] Invalid Essentials Pair: %s %s\n", bbb, ccc);
             return;
         }
         */
 
         if (essentials_cnt > 1) {
             if (!is_valid_essentials(bbb)) {
-                req->type = INVALID;
-                printf("[addReservation] Invalid Essential Item: %s (len = %d)\n", bbb, (int)strlen(bbb));
+                cmd->type = INVALID;
+                report("[addReservation] Invalid Essential Item: %.*s (len = %d)\n", (int)bbb.len, bbb.data, (int)bbb.len);
                 return;
             }
         }
 
         if (essentials_cnt == 2) {
             if (!is_valid_essentials(ccc)) {
-                req->type = INVALID;
-                printf("[addReservation] Invalid Essential Item: %s (len = %d)\n", ccc, (int)strlen(ccc));
+                cmd->type = INVALID;
+                report("[addReservation] Invalid Essential Item: %.*s (len = %d)\n", (int)ccc.len, ccc.data, (int)ccc.len);
                 return;
             }
         }
 
-        req->parking = true; 
-        req->essential = 0;
-        add_essential_value(&(req->essential), bbb);
-        add_essential_value(&(req->essential), ccc);
+        req->resources = RESOURCE_BIT(resource_parking());
+        add_essential_value(&(req->resources), bbb);
+        add_essential_value(&(req->resources), ccc);
         return;
     }
     
-    if (compare(type, "addEvent")) {
+    if (command->keyword == KW_ADD_EVENT) {
         // addEvent -aaa YYYY-MM-DD hh:mm n.n bbb ccc ddd; (bbb, ccc, ddd are optional "essential items", not necessarily paired)
         // parking  + essentials (optional)
     
         for (int i = 5; i <= 7; i++) {
-            if (tokens[i][0] != '\0' && !is_valid_essentials(tokens[i])) {
-                req->type = INVALID;
-                printf("[addEvent] Invalid Essential Item: %s (len = %d)\n", tokens[i], (int)strlen(tokens[i]));
+            if (tokens[i].len > 0 && !is_valid_essentials(tokens[i])) {
+                cmd->type = INVALID;
+                report("[addEvent] Invalid Essential Item: %.*s (len = %d)\n", (int)tokens[i].len, tokens[i].data, (int)tokens[i].len);
                 return;
             }
         }
 
-        const char* bbb = tokens[5];
-        const char* ccc = tokens[6];
-        const char* ddd = tokens[7];
-
-        req->parking = true;
-        req->essential = 0;
-
-        if (bbb[0]) add_essential_value(&req->essential, bbb);
-        if (ccc[0]) add_essential_value(&req->essential, ccc);
-        if (ddd[0]) add_essential_value(&req->essential, ddd);
+        req->resources = RESOURCE_BIT(resource_parking());
+        for (int i = 5; i <= 7; i++) {
+            if (tokens[i].len > 0) add_essential_value(&req->resources, tokens[i]);
+        }
         return;
     }
     
-    if (compare(type, "bookEssentials")) {
+    if (command->keyword == KW_BOOK_ESSENTIALS) {
         // bookEssentials -aaa YYYY-MM-DD hh:mm n.n bbb
         // no parking + essentials (mandatory), i.e., only book essentials without parking
 
-        const char* bbb = tokens[5];
-        if (strlen(bbb) == 0) {
-            req->type = INVALID;
-            printf("[bookEssentials] No Essential Item Received!\n");
+        StringView bbb = tokens[5];
+        if (bbb.len == 0) {
+            cmd->type = INVALID;
+            report("[bookEssentials] No Essential Item Received!\n");
             return;
         }
 
         if (!is_valid_essentials(bbb)) {
-            req->type = INVALID;
-            printf("[bookEssentials] Invalid Essential Item: %s (len = %d)\n", bbb, (int)strlen(bbb));
+            cmd->type = INVALID;
+            report("[bookEssentials] Invalid Essential Item: %.*s (len = %d)\n", (int)bbb.len, bbb.data, (int)bbb.len);
             return;
         }
 
-        req->parking = false;
-        req->essential = 0;
-        add_essential_value(&req->essential, bbb);
+        req->resources = 0;
+        add_essential_value(&req->resources, bbb);
         return;
     }
 
-    printf("Unrecognized Command: %s\n", type);
-    req->type = INVALID;
+    report("Unrecognized Command: %.*s\n", (int)tokens[0].len, tokens[0].data);
+    cmd->type = INVALID;
 }
-
@@ -11,6 +11,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+
+#include "resource.h"
+
 #define BUFFER_SIZE 512
 
 typedef struct Time {
@@ -27,41 +30,92 @@ typedef enum RequestType {
 } RequestType;
 
 
+// start and duration are below 2^REQUEST_TIME_BITS minutes (see MAX_HORIZON_DAYS in utils.h)
+#define REQUEST_TIME_BITS   23
+#define REQUEST_TIME_MASK   ((1u << REQUEST_TIME_BITS) - 1)
+#define ARG_LEN             100
+
 /**
- * Struct type for storing various information of a request.
+ * Struct type for storing a booking request. Packed into 16 bytes, since the queue and every
+ * result vector of the schedulers hold one per booking.
  *
- * @param type          The type of the request (PRINT, BATCH, NORMAL, INVALID)
+ * @param order         The position of the request in the queue (int, starts from 1)
+ * @param resources     The resources requested, one bit per resource of the registry
+ * @param start         The starting time of the request (in minutes)
+ * @param priority      The priority of the request (smaller is higher, 0 ~ 7)
+ * @param duration      The duration of the request (in minutes)
  * @param member        The member who made the request (A, B, C, ...)
- * @param start         The starting time of the request (int, in minutes)
- * @param duration      The duration of the request (int, in minutes)
- * @param priority      The priority of the request (int, smaller is higher)
- * @param parking       Whether the request needs parking
- * @param essential     The essential items requested (3-bit binary)
- * @param file          The file name of the batch request (only valid for BATCH)
- * @param algo          The algorithm name for printing (only valid for PRINT)
  * 
  */
 typedef struct Request {
-    RequestType type;
-    char member; // 'A', 'B', 'C' ... 
-    int start; 
-    int duration;
-    int priority; 
     int order; // start from 1
-    bool parking; // need parking or not
 
-    // 3 bit binary, battery + cable, locker + umbrella, InflationService + valetPark respectively
-    // E.g., 0b011 = (battery + cable) + (InflationService + valetPark);
-    char essential;
-    char* file;
-    char* algo;
+    // bit r = needs one instance of resource r (see resource.h)
+    // E.g., RESOURCE_BIT(resource_parking()) | RESOURCE_BIT(resource_lookup("battery"));
+    ResourceMask resources;
+    unsigned start : REQUEST_TIME_BITS;
+    unsigned priority : 3;
+    unsigned duration : REQUEST_TIME_BITS;
+    unsigned member : 8; // 'A', 'B', 'C' ... 
 } Request;
 
-Request fetch_input();
-Request file_input(FILE* file);
-Request preprocess_input(char*);
+_Static_assert(sizeof(Request) == 16, "Request must stay packed");
+
+/**
+ * Struct type for storing a parsed input line.
+ *
+ * @param type          The type of the command (PRINT, BATCH, REQUEST, INVALID, TERMINATE)
+ * @param request       The booking (only valid for REQUEST)
+ * @param file          The file name of the batch request (BATCH), or the file to print to, "" for
+ *                      stdout (PRINT)
+ * @param compiled      Where to write the batch compiled, "" for nowhere (only valid for BATCH)
+ * @param algo          The algorithm name for printing (only valid for PRINT)
+ * @param format        The output format for printing, "" for the tables (only valid for PRINT)
+ * 
+ */
+typedef struct Command {
+    RequestType type;
+    Request request;
+    char file[ARG_LEN];
+    char compiled[ARG_LEN];
+    char algo[ARG_LEN];
+    char format[ARG_LEN];
+} Command;
 
-void parse_input(const char tokens[8][100], Request* req);
+// A run of characters inside a larger buffer, not NUL-terminated.
+typedef struct StringView {
+    const char* data;
+    size_t len;
+} StringView;
+
+Command fetch_input();
+Command file_input(FILE* file);
+Command preprocess_input(const char*);
+
+/**
+ * Parses one input line in place, without allocating. Trailing whitespace and semicolons are
+ * ignored, and every ' ' ends a token (of which the first eight are read, cut to 99 characters).
+ */
+Command parse_line(const char* line, size_t len);
+
+/**
+ * Parses a line already cut into NUL-terminated tokens, as parse_line() does
+ */
+void parse_input(const char tokens[8][100], Command* cmd);
+
+// Text the parser would have printed, collected instead (see parse_set_messages()).
+typedef struct MessageBuffer {
+    char* data;     // not NUL-terminated
+    size_t size;
+    size_t capacity;
+} MessageBuffer;
+
+/**
+ * Makes the parser append what it reports about invalid lines in the calling thread to buffer,
+ * rather than print it. NULL prints it again
+ */
+void parse_set_messages(MessageBuffer* buffer);
+void message_buffer_free(MessageBuffer* buffer);
 
 
 #endif //INPUT_H
@@ -0,0 +1,264 @@
+#include "intervalset.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#define INIT_NODES  64
+#define PRIO_SEED   0x9e3779b9u
+
+// A maximal run of equal, non-zero values. Node 0 is the null node.
+typedef struct Interval {
+    int lo;             // key of the treap
+    int hi;
+    int val;
+    int submax;         // maximum val in the subtree
+    unsigned prio;
+    int left;
+    int right;
+} Interval;
+
+struct IntervalSet {
+    int start;
+    int end;
+    unsigned K;
+    int* roots;         // root of each instance
+    Interval* nodes;    // pool shared by all instances
+    int size;           // nodes ever handed out, including node 0
+    int capacity;
+    int free_head;      // free list, linked through left
+    unsigned prio_state;
+};
+
+/* PRIVATE METHODS */
+
+static int max2(int a, int b) { return a > b ? a : b; }
+
+static unsigned next_prio(IntervalSet* is) {
+    unsigned x = is->prio_state;  // xorshift32, deterministic across runs
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return is->prio_state = x;
+}
+
+static void reserve(IntervalSet* is, int capacity) {
+    if (is->capacity >= capacity) return;
+    int new_capacity = is->capacity;
+    while (new_capacity < capacity) new_capacity *= 2;
+    Interval* nodes = realloc(is->nodes, (size_t)new_capacity * sizeof(Interval));
+    if (!nodes) exit(1);
+    is->nodes = nodes;
+    is->capacity = new_capacity;
+}
+
+static int new_node(IntervalSet* is, int lo, int hi, int val) {
+    int p;
+    if (is->free_head) {
+        p = is->free_head;
+        is->free_head = is->nodes[p].left;
+    } else {
+        reserve(is, is->size + 1);
+        p = is->size++;
+    }
+    is->nodes[p] = (Interval){lo, hi, val, val, next_prio(is), 0, 0};
+    return p;
+}
+
+static void free_subtree(IntervalSet* is, int t) {
+    if (!t) return;
+    free_subtree(is, is->nodes[t].left);
+    free_subtree(is, is->nodes[t].right);
+    is->nodes[t].left = is->free_head;
+    is->free_head = t;
+}
+
+static void update(IntervalSet* is, int t) {
+    Interval* n = &is->nodes[t];
+    n->submax = max2(n->val, max2(is->nodes[n->left].submax, is->nodes[n->right].submax));
+}
+
+// Splits t into *a (lo < key) and *b (lo >= key).
+static void split(IntervalSet* is, int t, int key, int* a, int* b) {
+    if (!t) {
+        *a = *b = 0;
+        return;
+    }
+    if (is->nodes[t].lo < key) {
+        split(is, is->nodes[t].right, key, &is->nodes[t].right, b);
+        *a = t;
+    } else {
+        split(is, is->nodes[t].left, key, a, &is->nodes[t].left);
+        *b = t;
+    }
+    update(is, t);
+}
+
+// Every key of a must be smaller than every key of b.
+static int merge(IntervalSet* is, int a, int b) {
+    if (!a || !b) return a ? a : b;
+    if (is->nodes[a].prio > is->nodes[b].prio) {
+        is->nodes[a].right = merge(is, is->nodes[a].right, b);
+        update(is, a);
+        return a;
+    }
+    is->nodes[b].left = merge(is, a, is->nodes[b].left);
+    update(is, b);
+    return b;
+}
+
+static int last(const IntervalSet* is, int t) {
+    if (!t) return 0;
+    while (is->nodes[t].right) t = is->nodes[t].right;
+    return t;
+}
+
+// Node with the greatest lo <= key, 0 if none.
+static int floor_node(const IntervalSet* is, int t, int key) {
+    int best = 0;
+    while (t) {
+        if (is->nodes[t].lo <= key) {
+            best = t;
+            t = is->nodes[t].right;
+        } else {
+            t = is->nodes[t].left;
+        }
+    }
+    return best;
+}
+
+// Maximum val among nodes with lo >= key.
+static int max_ge(const IntervalSet* is, int t, int key) {
+    int res = 0;
+    while (t) {
+        const Interval* n = &is->nodes[t];
+        if (n->lo >= key) {
+            res = max2(res, max2(n->val, is->nodes[n->right].submax));
+            t = n->left;
+        } else {
+            t = n->right;
+        }
+    }
+    return res;
+}
+
+// Maximum val among nodes with lo <= key.
+static int max_le(const IntervalSet* is, int t, int key) {
+    int res = 0;
+    while (t) {
+        const Interval* n = &is->nodes[t];
+        if (n->lo <= key) {
+            res = max2(res, max2(n->val, is->nodes[n->left].submax));
+            t = n->right;
+        } else {
+            t = n->left;
+        }
+    }
+    return res;
+}
+
+// Maximum val among nodes with lo in [a, b].
+static int max_between(const IntervalSet* is, int t, int a, int b) {
+    while (t) {
+        const Interval* n = &is->nodes[t];
+        if (n->lo < a) t = n->right;
+        else if (n->lo > b) t = n->left;
+        else return max2(n->val, max2(max_ge(is, n->left, a), max_le(is, n->right, b)));
+    }
+    return 0;
+}
+
+/* PUBLIC METHODS */
+
+IntervalSet* intervalset_build(int start, int end, unsigned K) {
+    assert(end - start + 1 > 0);
+    IntervalSet* is = (IntervalSet*)malloc(sizeof(IntervalSet));
+    if (is == NULL) return NULL;
+    is->start = start;
+    is->end = end;
+    is->K = K;
+    is->roots = malloc(K * sizeof(int));
+    is->nodes = malloc(INIT_NODES * sizeof(Interval));
+    is->capacity = INIT_NODES;
+    if (!is->roots || !is->nodes) {
+        intervalset_destroy(is);
+        return NULL;
+    }
+    intervalset_empty(is);
+    return is;
+}
+
+void intervalset_destroy(IntervalSet* is) {
+    if (is == NULL) return;
+    free(is->roots);
+    free(is->nodes);
+    free(is);
+}
+
+void intervalset_empty(IntervalSet* is) {
+    for (unsigned k = 0; k < is->K; k++) is->roots[k] = 0;
+    is->nodes[0] = (Interval){0, 0, 0, 0, 0, 0, 0};
+    is->size = 1;
+    is->free_head = 0;
+    is->prio_state = PRIO_SEED;
+}
+
+void intervalset_range_set(IntervalSet* is, unsigned k, int l, int r, int val) {
+    assert(k < is->K && is->start <= l && l <= r && r <= is->end && val >= 0);
+    int a, b, c, rest;
+    split(is, is->roots[k], l, &a, &rest);
+    split(is, rest, r + 1, &b, &c);
+
+    // a may end with an interval running into [l, r], b may end with one running past r
+    int remainder = 0;
+    int p = last(is, a);
+    if (p && is->nodes[p].hi >= l) {
+        int hi = is->nodes[p].hi, pval = is->nodes[p].val;
+        is->nodes[p].hi = l - 1;  // key and val unchanged, so the treap stays valid
+        if (hi > r) remainder = new_node(is, r + 1, hi, pval);
+    }
+    int q = last(is, b);
+    if (q && is->nodes[q].hi > r) {
+        int hi = is->nodes[q].hi, qval = is->nodes[q].val;
+        remainder = new_node(is, r + 1, hi, qval);
+    }
+    free_subtree(is, b);
+
+    if (remainder) c = merge(is, remainder, c);
+    if (val) c = merge(is, new_node(is, l, r, val), c);
+    is->roots[k] = merge(is, a, c);
+}
+
+void intervalset_range_query(IntervalSet* is, int l, int r, int* results) {
+    assert(is->start <= l && l <= r && r <= is->end);
+    for (unsigned k = 0; k < is->K; k++) {
+        int t = is->roots[k];
+        int res = max_between(is, t, l, r);
+        int p = floor_node(is, t, l - 1);
+        if (p && is->nodes[p].hi >= l) res = max2(res, is->nodes[p].val);
+        results[k] = res;
+    }
+}
+
+int intervalset_first_free(IntervalSet* is, int l, int r) {
+    assert(is->start <= l && l <= r && r <= is->end);
+    for (unsigned k = 0; k < is->K; k++) {
+        // intervals are disjoint, so the one starting last before r also ends last
+        int p = floor_node(is, is->roots[k], r);
+        if (!p || is->nodes[p].hi < l) return (int)k;
+    }
+    return -1;
+}
+
+void intervalset_overwrite(IntervalSet* source, IntervalSet* target) {
+    assert(source && target && source->K == target->K);
+    reserve(target, source->size);
+    memcpy(target->nodes, source->nodes, (size_t)source->size * sizeof(Interval));
+    memcpy(target->roots, source->roots, source->K * sizeof(int));
+    target->start = source->start;
+    target->end = source->end;
+    target->size = source->size;
+    target->free_head = source->free_head;
+    target->prio_state = source->prio_state;
+}
@@ -0,0 +1,71 @@
+#ifndef INTERVALSET_H
+#define INTERVALSET_H
+
+/**
+ * Opaque handle representing K parallel ordered sets of disjoint occupied intervals.
+ * Each instance is a treap keyed by interval start, so memory and copy cost scale with the
+ * number of bookings instead of the horizon length.
+ * Positions not covered by any interval hold 0. The interface mirrors segtree.h.
+ */
+typedef struct IntervalSet IntervalSet;
+
+/**
+ * Creates K empty interval sets over [start, end]
+ *
+ * @param start     Start index of all sets (inclusive)
+ * @param end       End index of all sets (inclusive)
+ * @param K         Number of parallel instances
+ * @return          New handle. Must be destroyed with intervalset_destroy(). NULL on allocation failure
+ */
+IntervalSet* intervalset_build(int start, int end, unsigned K);
+
+/**
+ * Safely destroys the sets and releases all resources
+ *
+ * @param is        Handle from intervalset_build(). No-op if NULL
+ */
+void intervalset_destroy(IntervalSet* is);
+
+/**
+ * Removes every interval of every instance
+ * @param is        Pointer to the interval set to be emptied
+ */
+void intervalset_empty(IntervalSet* is);
+
+/**
+ * Sets all elements of [l, r] of instance k to val. Overlapped intervals are trimmed or split.
+ *
+ * @param is        Handle from intervalset_build()
+ * @param k         Index of target instance (0 ≤ k < K)
+ * @param l         Left range boundary to update (inclusive)
+ * @param r         Right range boundary to update (inclusive)
+ * @param val       Value to set for all elements in [l, r]. 0 frees the range
+ */
+void intervalset_range_set(IntervalSet* is, unsigned k, int l, int r, int val);
+
+/**
+ * Queries all K instances for the maximum value in [l, r]
+ *
+ * @param is        Handle from intervalset_build()
+ * @param l         Left query boundary (inclusive)
+ * @param r         Right query boundary (inclusive)
+ * @param results   Pre-allocated output array (size ≥ K).
+ */
+void intervalset_range_query(IntervalSet* is, int l, int r, int* results);
+
+/**
+ * Finds the lowest-indexed instance with no interval overlapping [l, r]. O(K log n).
+ *
+ * @return          Index of the first free instance, -1 if every instance is occupied
+ */
+int intervalset_first_free(IntervalSet* is, int l, int r);
+
+/**
+ * Overwrites the contents of target with source. Copies only the stored intervals.
+ *
+ * @param source    Source interval set to copy from
+ * @param target    Target interval set to copy to
+ */
+void intervalset_overwrite(IntervalSet* source, IntervalSet* target);
+
+#endif // INTERVALSET_H
@@ -0,0 +1,141 @@
+//
+// journal.c
+// Undo log for a Tracker and the accepted / rejected lists built on it
+//
+
+#include "journal.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#define INIT_CAPACITY 64
+
+/* PRIVATE METHODS */
+
+// Puts the moved requests of batch b back into b->from at their original positions.
+static void undo_batch(Journal* j, const MoveBatch* b) {
+    assert(b->to->size >= b->count);
+    b->to->size -= b->count;
+
+    int survivors = b->from->size;
+    index_list_reserve(b->from, survivors + b->count);
+    b->from->size = survivors + b->count;
+
+    // merge from the back, so that every element is moved at most once
+    int i = survivors - 1;
+    int m = b->count - 1;
+    for (int pos = b->from->size - 1; m >= 0; pos--) {
+        if (j->moved_index[b->first + m] == pos) {
+            b->from->data[pos] = j->moved.data[b->first + m];
+            m--;
+        } else {
+            b->from->data[pos] = b->from->data[i--];
+        }
+    }
+}
+
+/* PUBLIC METHODS */
+
+void journal_init(Journal* j) {
+    j->writes = malloc(INIT_CAPACITY * sizeof(TrackerWrite));
+    j->writes_size = 0;
+    j->writes_capacity = INIT_CAPACITY;
+
+    j->batches = malloc(INIT_CAPACITY * sizeof(MoveBatch));
+    j->batches_size = 0;
+    j->batches_capacity = INIT_CAPACITY;
+
+    j->moved = (IndexList){0};
+    index_list_reserve(&j->moved, INIT_CAPACITY);
+    j->moved_index = malloc(INIT_CAPACITY * sizeof(int));
+    j->moved_capacity = INIT_CAPACITY;
+    j->allocations = 3;
+}
+
+void journal_free(Journal* j) {
+    free(j->writes);
+    free(j->batches);
+    index_list_free(&j->moved);
+    free(j->moved_index);
+    j->writes = NULL;
+    j->batches = NULL;
+    j->moved_index = NULL;
+}
+
+void journal_reserve(Journal* j, int writes, int batches, int moves) {
+    if (j->writes_capacity < writes) {
+        j->writes_capacity = writes;
+        j->writes = realloc(j->writes, (size_t)writes * sizeof(TrackerWrite));
+        if (!j->writes) exit(1);
+        j->allocations++;
+    }
+    if (j->batches_capacity < batches) {
+        j->batches_capacity = batches;
+        j->batches = realloc(j->batches, (size_t)batches * sizeof(MoveBatch));
+        if (!j->batches) exit(1);
+        j->allocations++;
+    }
+    if (j->moved_capacity < moves) {
+        j->moved_capacity = moves;
+        j->moved_index = realloc(j->moved_index, (size_t)moves * sizeof(int));
+        if (!j->moved_index) exit(1);
+        j->allocations++;
+    }
+    index_list_reserve(&j->moved, moves);
+}
+
+void journal_log_write(Journal* j, unsigned res, unsigned k, int l, int r, int prev) {
+    if (j->writes_size == j->writes_capacity) {
+        j->writes_capacity *= 2;
+        j->writes = realloc(j->writes, (size_t)j->writes_capacity * sizeof(TrackerWrite));
+        if (!j->writes) exit(1);
+        j->allocations++;
+    }
+    j->writes[j->writes_size++] = (TrackerWrite){res, k, l, r, prev};
+}
+
+void journal_begin_moves(Journal* j, IndexList* from, IndexList* to) {
+    if (j->batches_size == j->batches_capacity) {
+        j->batches_capacity *= 2;
+        j->batches = realloc(j->batches, (size_t)j->batches_capacity * sizeof(MoveBatch));
+        if (!j->batches) exit(1);
+        j->allocations++;
+    }
+    j->batches[j->batches_size++] = (MoveBatch){from, to, j->moved.size, 0};
+}
+
+void journal_log_move(Journal* j, int index, uint32_t req) {
+    assert(j->batches_size > 0);
+    MoveBatch* b = &j->batches[j->batches_size - 1];
+    assert(b->count == 0 || j->moved_index[b->first + b->count - 1] < index);
+
+    if (j->moved.size == j->moved_capacity) {
+        j->moved_capacity *= 2;
+        j->moved_index = realloc(j->moved_index, (size_t)j->moved_capacity * sizeof(int));
+        if (!j->moved_index) exit(1);
+        j->allocations++;
+    }
+    j->moved_index[j->moved.size] = index;
+    index_list_add(&j->moved, req);
+    b->count++;
+}
+
+void journal_commit(Journal* j) {
+    j->writes_size = 0;
+    j->batches_size = 0;
+    j->moved.size = 0;
+}
+
+void journal_rollback(Journal* j, Tracker* tracker) {
+    // undo directly through the backend, so that the undo itself is not journaled
+    for (int i = j->writes_size - 1; i >= 0; i--) {
+        const TrackerWrite* w = &j->writes[i];
+        tracker->ops->range_set(tracker->index[w->res], w->k, w->l, w->r, w->prev);
+        // every write books a free range or frees a booked one, so its undo does the opposite
+        tracker->busy[w->res] += (w->prev ? 1 : -1) * (long long)(w->r - w->l + 1);
+    }
+    for (int i = j->batches_size - 1; i >= 0; i--) {
+        undo_batch(j, &j->batches[i]);
+    }
+    journal_commit(j);
+}
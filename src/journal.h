@@ -0,0 +1,87 @@
+//
+// journal.h
+// Undo log for a Tracker and the accepted / rejected lists built on it
+//
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "state.h"
+#include "reqtable.h"
+
+// One range assignment made through try_put() / try_delete().
+typedef struct TrackerWrite {
+    unsigned res;   // resource, i.e. the write went to tracker->index[res]
+    unsigned k;     // instance inside the resource
+    int l;
+    int r;
+    int prev;       // value of [l, r] before the write
+} TrackerWrite;
+
+// A stable partition of `from` that moved some of its requests to the tail of `to`.
+typedef struct MoveBatch {
+    IndexList* from;
+    IndexList* to;
+    int first;      // first entry of the batch in Journal.moved
+    int count;
+} MoveBatch;
+
+// The Journal struct records every change made to a Tracker and its request lists since the
+// last journal_commit(), so that journal_rollback() can undo them in time proportional to the
+// number of changes, instead of restoring full copies.
+// Attach it with tracker->journal = &journal to make try_put() / try_delete() log their writes.
+struct Journal {
+    TrackerWrite* writes;
+    int writes_size;
+    int writes_capacity;
+
+    MoveBatch* batches;
+    int batches_size;
+    int batches_capacity;
+
+    IndexList moved;        // the moved requests, in the order they were moved
+    int* moved_index;       // index of each moved request inside `from` before the partition
+    int moved_capacity;
+
+    unsigned long allocations;  // times the arrays above were allocated or grown, `moved` excluded
+};
+
+void journal_init(Journal* j);
+void journal_free(Journal* j);
+
+/**
+ * Makes room for `writes` writes, `batches` batches and `moves` moves between two commits,
+ * so that logging them never allocates.
+ */
+void journal_reserve(Journal* j, int writes, int batches, int moves);
+
+/**
+ * Records a range assignment. Called by try_put() / try_delete() on a journaled Tracker.
+ */
+void journal_log_write(Journal* j, unsigned res, unsigned k, int l, int r, int prev);
+
+/**
+ * Starts a new batch of moves from `from` to `to`.
+ * Every move logged until the next call belongs to this batch.
+ */
+void journal_begin_moves(Journal* j, IndexList* from, IndexList* to);
+
+/**
+ * Records that from->data[index] == req (index taken before the partition started) was appended to `to`.
+ * Indices of one batch must be strictly increasing.
+ */
+void journal_log_move(Journal* j, int index, uint32_t req);
+
+/**
+ * Accepts every change since the last commit. O(1).
+ */
+void journal_commit(Journal* j);
+
+/**
+ * Undoes every change since the last commit, newest first.
+ * The tracker (including its busy counters) and all lists involved are restored exactly,
+ * including the order of the lists.
+ */
+void journal_rollback(Journal* j, Tracker* tracker);
+
+#endif // JOURNAL_H
@@ -3,30 +3,39 @@
 #include "vector.h"
 #include "utils.h"
 #include "rng.h"
+#include "journal.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <time.h>
 
-static int T_min, T_max;
-
 /* SA Hyperparams */
 static const double P = 0.9;
 static const double Q = 0.3;
 static const double INI_P = 0.99;
 static const double END_P = 0.01;
 static const int MAX_STEPS = 1000;
+// A warm start begins from a good schedule already, so it anneals shorter and cooler
+static const double WARM_INI_P = 0.3;
+static const int WARM_STEPS = 200;
+
+static unsigned workers = 1;
+
+static OptiWorkspace ws;
+static const RequestTable* table = NULL;    // of the current run
 
-static Vector* pre_accepted = NULL;
-static Vector* pre_rejected = NULL;
-static Tracker* pre_tracker = NULL;
-static Vector* best_accepted = NULL;
-static Vector* best_rejected = NULL;
+// Every SA step is journaled, so that a rejected step is undone in time proportional to the
+// number of moved requests. With TRACKER_PERSISTENT, storing the best state is an O(1) snapshot.
+// Both are kept across runs, like the workspace.
+static Journal journal;
+static bool journal_ready = false;
+static TrackerSnapshot best_snapshot;
 
 // the following needs reset everytime
 double decay, cur_t;
-int cur_step; 
+int cur_step, max_steps;
 double best_util = 0.0;
 
 static double fast_pow(double base, int exponent) {
@@ -39,40 +48,83 @@ static double fast_pow(double base, int exponent) {
     return sign ? 1.0 / res : res;
 }
 
-void opti_store_best(Vector* accepted, Vector* rejected, double new_util) {
+void opti_store_best(IndexList* accepted, IndexList* rejected, Tracker* tracker, double new_util) {
     if (new_util > best_util) {
         best_util = new_util;
-        vector_overwrite(accepted, best_accepted);
-        vector_overwrite(rejected, best_rejected);
+        index_list_overwrite(accepted, &ws.best_accepted);
+        index_list_overwrite(rejected, &ws.best_rejected);
+        tracker_snapshot(tracker, &best_snapshot);
     }
 }
 
-void opti_get_best_accepted(Vector* target) {
-    vector_overwrite(best_accepted, target);
+void opti_get_best_accepted(IndexList* target) {
+    index_list_overwrite(&ws.best_accepted, target);
 }
 
-void opti_get_best_rejected(Vector* target) {
-    vector_overwrite(best_rejected, target);
+void opti_get_best_rejected(IndexList* target) {
+    index_list_overwrite(&ws.best_rejected, target);
 }
 
-void opti_reset() {
-    T_min = parse_time("2025-05-10", "00:00");
-    T_max = parse_time("2025-05-16", "23:59");
-    assert(T_min < T_max && T_max - T_min + 1 == 10080);
-    assert(INI_P <= 1.0);
+void opti_get_best_tracker(Tracker* target) {
+    assert(target->journal == &journal && journal.writes_size == 0);
+    target->journal = NULL;
+    tracker_restore(target, &best_snapshot);
+    tracker_free_snapshot(&best_snapshot);
+}
+
+// Grows the workspace and the journal to what a run over queue can use between two commits:
+// every request moved twice (opti_delete, then opti_greedy), each writing all of its resources.
+static void reserve_workspace(void) {
+    int n = table->size, writes = 0;
+    for (int i = 0; i < n; i++) writes += 2 * (int)resource_mask_count(table->resources[i]);
 
-    assert(pre_accepted == NULL && pre_rejected == NULL && pre_tracker == NULL && best_accepted == NULL && best_rejected == NULL);
+    if (!journal_ready) {
+        journal_init(&journal);
+        journal_ready = true;
+    }
+    journal_reserve(&journal, writes, 2, 2 * n);
+
+    index_list_reserve(&ws.accepted, n);
+    index_list_reserve(&ws.rejected, n);
+    index_list_reserve(&ws.best_accepted, n);
+    index_list_reserve(&ws.best_rejected, n);
+    index_list_reserve(&ws.scratch, n);
+    if (ws.capacity < n) {
+        unsigned char* grown = realloc(ws.coins, (size_t)n);
+        if (grown == NULL) exit(1);
+        ws.coins = grown;
+        ws.capacity = n;
+        ws.allocations++;
+    }
+}
+
+OptiWorkspace* opti_reset(Tracker* tracker, const RequestTable* requests, const IndexList* warm) {
+    assert(INI_P <= 1.0 && WARM_INI_P <= 1.0);
+    assert(tracker->journal == NULL);
+
+    table = requests;
+    reserve_workspace();
+    ws.accepted.size = 0;
+    ws.rejected.size = 0;
+    if (warm) {
+        // coins is free until the first pass, mark the rows the tracker holds with it
+        memset(ws.coins, 0, (size_t)table->size);
+        for (int i = 0; i < warm->size; i++) {
+            ws.coins[warm->data[i]] = 1;
+            index_list_add(&ws.accepted, warm->data[i]);
+        }
+    }
+    for (int i = 0; i < table->size; i++) {
+        if (!warm || !ws.coins[i]) index_list_add(&ws.rejected, (uint32_t)i);
+    }
+    ws.best_accepted.size = 0;
+    ws.best_rejected.size = 0;
+    best_util = 0.0;
 
-    pre_accepted = malloc(sizeof(Vector));
-    pre_rejected = malloc(sizeof(Vector));
-    pre_tracker = malloc(sizeof(Tracker));
-    best_accepted = malloc(sizeof(Vector));
-    best_rejected = malloc(sizeof(Vector));
-    vector_init(pre_accepted);
-    vector_init(pre_rejected);
-    vector_init(best_accepted);
-    vector_init(best_rejected);
-    init_tracker(pre_tracker);
+    best_snapshot = (TrackerSnapshot){0};
+    tracker_snapshot(tracker, &best_snapshot);
+    journal_commit(&journal);
+    tracker->journal = &journal;
 
     double ref = -0.1;  // reference new_e - e
     double eps = 1e-9;
@@ -80,75 +132,83 @@ void opti_reset() {
 
     // exp(ref / start_t) = INI_P
     // exp(ref / end_t) = END_P
-    double start_t = ref / log(INI_P);
+    max_steps = warm ? WARM_STEPS : MAX_STEPS;
+    double start_t = ref / log(warm ? WARM_INI_P : INI_P);
     double end_t = ref / log(END_P);
 
     while (r - l > eps) {
         decay = (r + l) / 2.0;
-        if (start_t * fast_pow(decay, MAX_STEPS) > end_t) r = decay;
+        if (start_t * fast_pow(decay, max_steps) > end_t) r = decay;
         else l = decay; // too fast
     }
     
     cur_t = start_t;
     cur_step = 0;
+    return &ws;
+}
+
+void opti_rollback(Tracker* tracker) {
+    journal_rollback(&journal, tracker);
+    tracker_collect(tracker, (TrackerSnapshot*[]){&best_snapshot}, 1);
 }
 
-void opti_rollback(Vector* rejected, Vector* accepted, Tracker* tracker) {
-    tracker_overwrite(pre_tracker, tracker);
-    vector_overwrite(pre_accepted, accepted);
-    vector_overwrite(pre_rejected, rejected);
+void opti_backup(Tracker* tracker) {
+    journal_commit(&journal);
+    tracker_collect(tracker, (TrackerSnapshot*[]){&best_snapshot}, 1);
 }
 
-void opti_backup(Vector* rejected, Vector* accepted, Tracker* tracker) {
-    tracker_overwrite(tracker, pre_tracker);
-    vector_overwrite(rejected, pre_rejected);
-    vector_overwrite(accepted, pre_accepted);
+// One Bernoulli draw per request of a greedy/delete pass, filled in bulk before the pass.
+// It consumes the generator exactly like one randd() per request did.
+static const unsigned char* flip_coins(int n, double p) {
+    assert(n <= ws.capacity);
+    rng_fill_bernoulli(rng_global(), ws.coins, n, p);
+    return ws.coins;
 }
 
-void opti_greedy(Vector* rejected, Vector* accepted, Tracker* tracker, bool rand) {
-    Vector* tmp_rejected = malloc(sizeof(Vector));
-    vector_init(tmp_rejected);
+// Both passes are stable partitions done in place: the requests that stay are compacted towards
+// the front of `from` (never ahead of the one being read), the others are appended to `to`.
+void opti_greedy(IndexList* rejected, IndexList* accepted, Tracker* tracker, bool rand) {
+    if (tracker->journal) journal_begin_moves(tracker->journal, rejected, accepted);
+    const unsigned char* coin = rand ? flip_coins(rejected->size, P) : NULL;
 
+    int kept = 0;
     for (int i = 0; i < rejected->size; i++) {
-        Request* req = &rejected->data[i];
-        int end = req->start + req->duration - 1;
-        if ((!rand || randd() < P) && try_put(req->order, req->start, end, req->parking, req->essential, tracker)) {
-            vector_add(accepted, *req);
+        uint32_t req = rejected->data[i];
+        if ((!rand || coin[i]) &&
+            try_put(table->order[req], table->start[req], table->end[req], table->resources[req], tracker)) {
+            if (tracker->journal) journal_log_move(tracker->journal, i, req);
+            index_list_add(accepted, req);
         } else {
-            vector_add(tmp_rejected, *req);
+            rejected->data[kept++] = req;
         }
     }
-    vector_overwrite(tmp_rejected, rejected);
+    rejected->size = kept;
 }
 
-void opti_delete(Vector* rejected, Vector* accepted, Tracker* tracker) {
-    Vector* tmp_accepted = malloc(sizeof(Vector));
-    vector_init(tmp_accepted);
+void opti_delete(IndexList* rejected, IndexList* accepted, Tracker* tracker) {
+    if (tracker->journal) journal_begin_moves(tracker->journal, accepted, rejected);
+    const unsigned char* coin = flip_coins(accepted->size, Q);
 
+    int kept = 0;
     for (int i = 0; i < accepted->size; i++) {
-        Request* req = &accepted->data[i];
-        int end = req->start + req->duration - 1;
-        if (randd() < Q) {
-            try_delete(req->order, req->start, end, req->parking, req->essential, tracker);
-            vector_add(rejected, *req);
+        uint32_t req = accepted->data[i];
+        if (coin[i]) {
+            try_delete(table->order[req], table->start[req], table->end[req], table->resources[req], tracker);
+            if (tracker->journal) journal_log_move(tracker->journal, i, req);
+            index_list_add(rejected, req);
         } else {
-            vector_add(tmp_accepted, *req);
+            accepted->data[kept++] = req;
         }
     }
-    vector_overwrite(tmp_accepted, accepted);
+    accepted->size = kept;
 }
 
-double opti_util(Vector* accepted) {
-    int util = 0;
-    for (int i = 0; i < accepted->size; i++) {
-        Request* req = &accepted->data[i];
-        int ess_cnt = ((req->essential & 0b100) ? 1 : 0) +
-                      ((req->essential & 0b010) ? 1 : 0) +
-                      ((req->essential & 0b001) ? 1 : 0);
-        int park_cnt = req->parking ? 1 : 0;
-        util += (req->duration) * (ess_cnt + park_cnt);
-    }
-    return (double)util / (double)((T_max - T_min + 1) * 19);
+unsigned long opti_allocations() {
+    return index_list_allocations() + (journal_ready ? journal.allocations : 0) + ws.allocations;
+}
+
+double opti_util(const Tracker* tracker) {
+    return tracker_total_utilization(tracker);
 }
 
 bool opti_accept(double new_util, double old_util) {
@@ -162,8 +222,16 @@ void opti_iter() {
     cur_t *= decay;
 }
 
+void opti_set_workers(unsigned n) {
+    workers = n ? n : 1;
+}
+
+unsigned opti_workers() {
+    return workers;
+}
+
 bool opti_running() {
-    return cur_step < MAX_STEPS;
+    return cur_step < max_steps;
 }
 
 
@@ -3,37 +3,76 @@
 
 #include "input.h"
 #include "state.h"
+#include "reqtable.h"
+
+// The buffers an OPTI run works in. opti_reset() sizes them once for the whole queue, so that the
+// annealing loop itself never allocates (see opti_allocations()). They are kept and reused by later runs.
+typedef struct OptiWorkspace {
+    IndexList accepted;         // current state, annealed by the caller
+    IndexList rejected;
+    IndexList best_accepted;    // best state so far, see opti_store_best()
+    IndexList best_rejected;
+    IndexList scratch;          // for index_list_sort() of rejected
+    unsigned char* coins;       // one random draw per request of a pass
+    int capacity;               // requests coins can hold
+    unsigned long allocations;  // times coins was allocated or grown
+} OptiWorkspace;
 
 /**
  * @brief Resets the internal state of the opti module. This includes resetting the current temperature, current step, and decay rate.
+ * @param tracker The tracker to optimize on, preferably TRACKER_PERSISTENT. Journaled until opti_get_best_tracker()
+ * @param requests The requests to schedule, until the next opti_reset()
+ * @param warm NULL to start from an empty tracker with every request rejected. Otherwise the rows the tracker
+ * already holds, e.g. the best schedule of an earlier run over a prefix of requests: the workspace starts with
+ * them accepted and the others rejected, and the annealing schedule is shorter and cooler
+ * @return The workspace, whose accepted and rejected lists of rows the caller anneals
  * @note This function should be called before starting the optimization process.
  */
-void opti_reset();
+OptiWorkspace* opti_reset(Tracker* tracker, const RequestTable* requests, const IndexList* warm);
+
+/**
+ * @return The heap allocations made so far by index lists, the journal and the workspace.
+ * Does not change while annealing, i.e. between opti_reset() and opti_get_best_tracker()
+ */
+unsigned long opti_allocations();
+
+/**
+ * @brief Undoes every change to the tracker, accepted and rejected since the last opti_backup(),
+ * by replaying the journal in reverse. Costs time proportional to the number of moved requests.
+ */
+void opti_rollback(Tracker* tracker);
+
+/**
+ * @brief Accepts the current state by truncating the journal. O(1).
+ */
+void opti_backup(Tracker* tracker);
 
-void opti_rollback(Vector* rejected, Vector* accepted, Tracker* tracker);
-void opti_backup(Vector* rejected, Vector* accepted, Tracker* tracker);
+void opti_store_best(IndexList* accepted, IndexList* rejected, Tracker* tracker, double new_util);
+void opti_get_best_accepted(IndexList* target);
+void opti_get_best_rejected(IndexList* target);
 
-void opti_store_best(Vector* accepted, Vector* rejected, double new_util);
-void opti_get_best_accepted(Vector* target);
-void opti_get_best_rejected(Vector* target);
+/**
+ * @brief Stops journaling and restores the best state into the tracker.
+ */
+void opti_get_best_tracker(Tracker* target);
 
 /**
  * @brief Improved LJF Greedy algorithm. Move request from rejected to accepted, then resize.
- * @param rejected The vector of rejected requests (will decrease)
- * @param accepted The vector of accepted requests (will increase)
+ * @param rejected The rows of the rejected requests (will decrease)
+ * @param accepted The rows of the accepted requests (will increase)
  * @param tracker The segment tree of the current state
  */
 
-void opti_greedy(Vector* rejected, Vector* accepted, Tracker* tracker, bool rand);
+void opti_greedy(IndexList* rejected, IndexList* accepted, Tracker* tracker, bool rand);
 
 /**
  * @brief Delete the request from accepted to rejected, then resize.
- * @param rejected The vector of rejected requests (will increase)
- * @param accepted The vector of accepted requests (will decrease)
+ * @param rejected The rows of the rejected requests (will increase)
+ * @param accepted The rows of the accepted requests (will decrease)
  * @param tracker The segment tree of the current state
  * 
  */
-void opti_delete(Vector* rejected, Vector* accepted, Tracker* tracker);
+void opti_delete(IndexList* rejected, IndexList* accepted, Tracker* tracker);
 
 /**
  * @return If opti has reached maximum steps
@@ -41,11 +80,11 @@ void opti_delete(Vector* rejected, Vector* accepted, Tracker* tracker);
 bool opti_running();
 
 /**
- * @brief Calculate the utilization of the accepted requests
- * @param accepted The vector of accepted requests
+ * @brief Calculate the utilization of the accepted requests, from the tracker's busy counters in O(resources)
+ * @param tracker The tracker the accepted requests were put into
  * @return The utilization of the accepted requests
  */
-double opti_util(Vector* accepted);
+double opti_util(const Tracker* tracker);
 
 /**
  * @brief Accept or reject the new request based on the old utilization
@@ -55,6 +94,15 @@ double opti_util(Vector* accepted);
  */
 bool opti_accept(double new_util, double old_util);
 
+#define MAX_OPTI_WORKERS 256
+
+/**
+ * @brief Sets how many independent annealing chains run_opti() forks. 1 (the default) runs a
+ * single chain in the calling process.
+ */
+void opti_set_workers(unsigned workers);
+unsigned opti_workers();
+
 /**
  * @brief Iterate the algorithm. Incr current step and decr the current temperature
  */
@@ -9,8 +9,11 @@
 
 #include "scheduler.h"
 #include "state.h"
+#include "utils.h"
 #include "vector.h"
 
+#include <signal.h>
+#include <string.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <sys/wait.h>
@@ -26,32 +29,144 @@
 #define TYPE_LEN        13
 #define DEVICE_LEN      29
 
-#define TOTAL_MINUTES   10080  // 7 * 1440
 
+bool pipe_write(int fd, const void* buf, size_t len) {
+    const char* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool pipe_read(int fd, void* buf, size_t len) {
+    char* p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+
+// Booking tables are formatted into this buffer and written to stdout in blocks of this size.
+#define OUTPUT_BUFFER_SIZE  (64 << 10)
+
+static struct {
+    char data[OUTPUT_BUFFER_SIZE];
+    size_t size;
+    int fd;
+} out;
+
+// Must be called before the buffer is used, since the stream may hold text printed before.
+static void out_begin(FILE* stream) {
+    fflush(stream);
+    out.fd = fileno(stream);
+}
+
+static void out_flush(void) {
+    pipe_write(out.fd, out.data, out.size);
+    out.size = 0;
+}
+
+// Makes room for len more characters, flushing if necessary.
+static char* out_reserve(size_t len) {
+    assert(len <= OUTPUT_BUFFER_SIZE);
+    if (out.size + len > OUTPUT_BUFFER_SIZE) out_flush();
+    return out.data + out.size;
+}
+
+static void out_write(const char* str, size_t len) {
+    if (len > OUTPUT_BUFFER_SIZE) {
+        out_flush();
+        pipe_write(out.fd, str, len);
+        return;
+    }
+    memcpy(out_reserve(len), str, len);
+    out.size += len;
+}
+
+static void out_str(const char* str) {
+    out_write(str, strlen(str));
+}
+
+static void out_char(char c) {
+    *out_reserve(1) = c;
+    out.size++;
+}
+
+// Writes str cut or padded with spaces to exactly `width` characters.
+static void out_padded(const char* str, size_t width) {
+    char* p = out_reserve(width);
+    size_t len = strnlen(str, width);
+    memcpy(p, str, len);
+    memset(p + len, ' ', width - len);
+    out.size += width;
+}
+
+static void out_int(int num) {
+    char digits[12];
+    int n = 0;
+    unsigned value = num < 0 ? 0u - (unsigned)num : (unsigned)num;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    if (num < 0) digits[n++] = '-';
+
+    char* p = out_reserve((size_t)n);
+    for (int i = 0; i < n; i++) p[i] = digits[n - 1 - i];
+    out.size += (size_t)n;
+}
 
-typedef enum {
-    DONE,               // Tell the child to exit / tell the parent the current task is done.
-    PRINT_BOOKINGS,     // Tell the child to print its bookings.
-    PRINT_REPORT        // Tell the child to print its reports.
-} PipeMessageType;
+// Writes the hh:mm of a time, counted in minutes.
+static void out_clock(int minutes) {
+    const int remaining_minutes = minutes % (24 * 60);
+    const int hour = remaining_minutes / 60, minute = remaining_minutes % 60;
+    char* p = out_reserve(5);
+    p[0] = (char)('0' + hour / 10);
+    p[1] = (char)('0' + hour % 10);
+    p[2] = ':';
+    p[3] = (char)('0' + minute / 10);
+    p[4] = (char)('0' + minute % 10);
+    out.size += 5;
+}
+
+// Writes the YYYY-MM-DD of a time, formatting each day of the horizon once.
+static void out_date(int minutes) {
+    static char dates[MAX_HORIZON_DAYS][DATE_STRING_LEN];
+    static int dates_first_day = -1;   // horizon_start_day() the dates were formatted for
+    if (dates_first_day != horizon_start_day()) {
+        memset(dates, 0, sizeof(dates));
+        dates_first_day = horizon_start_day();
+    }
+
+    const int day = minutes / (24 * 60);
+    if (dates[day][0] == '\0') format_date(minutes, dates[day]);
+    out_str(dates[day]);
+}
 
 
 static void print_header() {
-    printf("Date         Start    End      Type          Device                        \n");
-    printf("===========================================================================\n");
+    out_str("Date         Start    End      Type          Device                        \n");
+    out_str("===========================================================================\n");
 }
 
 static void print_divider() {
-    printf("\n... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ...\n\n");
+    out_str("\n... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ... ...\n\n");
 }
 
 static void print_no_record() {
-    printf("   No record for this member.\n");
+    out_str("   No record for this member.\n");
 }
 
 static void print_end() {
-    printf("   - End -\n\n");
-    printf("===========================================================================\n\n");
+    out_str("   - End -\n\n");
+    out_str("===========================================================================\n\n");
 }
 
 
@@ -72,327 +187,575 @@ char* get_request_typename(const Request* req) {
 }
 
 
-// Adjust the string into a fixed size of `fixed_len`.
-// call free() when the adjusted string is out of use!
-char* adjust_string(const char* str, size_t fixed_len) {
-    char *result = malloc(fixed_len + 1);
-    if (result == NULL) {
-        perror("failed to allocate memory");
-        return NULL;
-    }
-
-    size_t len = strlen(str);
-
-    if (len < fixed_len) { // copy and padding
-        memcpy(result, str, len);
-        for (size_t i = len; i < fixed_len; i++) {
-            result[i] = ' ';
-        }
-    } else { // copy and cut
-        memcpy(result, str, fixed_len);
-    }
-
-    result[fixed_len] = '\0';
-    return result;
-}
-
-void get_2_digit_string(char str[], int num) {
-    str[0] = (char)('0' + (num / 10));
-    str[1] = (char)('0' + (num % 10));
-    str[2] = '\0';
-}
-
-char* get_date_string(const Request* req) {
-    const int total_days = req->start / (24 * 60);
-    char day[3];
-    get_2_digit_string(day, 10 + total_days);
-    char* date_string = malloc(11);
-    sprintf(date_string, "2025-05-%s", day);
-    return date_string;
-}
-
-// Good implementation
-char* get_start_string(const Request* req) {
-    const int remaining_minutes = req->start % (24 * 60);
-
-    char hour[3], minute[3];
-    get_2_digit_string(hour, remaining_minutes / 60);
-    get_2_digit_string(minute, remaining_minutes % 60);
-
-    char* start_string = malloc(6);
-    sprintf(start_string, "%s:%s", hour, minute);
-    return start_string;
-}
-
-// Good implementation
-char* get_end_string(const Request* req) {
-    const int remaining_minutes = (req->start + req->duration) % (24 * 60);
-
-    char hour[3], minute[3];
-    get_2_digit_string(hour, remaining_minutes / 60);
-    get_2_digit_string(minute, remaining_minutes % 60);
-
-    char* start_string = malloc(6);
-    sprintf(start_string, "%s:%s", hour, minute);
-    return start_string;
-}
-
-
 void
-print_algorithm_report(const char* algo_name, Statistics* stat, const int invalid_cnt) {
-    printf(" For %s:\n", algo_name);
+print_algorithm_report(FILE* stream, const char* algo_name, Statistics* stat, const Tracker* tracker, const int invalid_cnt) {
+    fprintf(stream, " For %s:\n", algo_name);
 
     int received_cnt = stat->accepted.size + stat->rejected.size;
 
     if (received_cnt > 0) {
-        printf("         Total Number of Booking Received: %d (100.00%%)\n", received_cnt);
+        fprintf(stream, "         Total Number of Booking Received: %d (100.00%%)\n", received_cnt);
 
-        printf("         Total Number of Booking Assigned: %d (%.2f%%)\n",
+        fprintf(stream, "         Total Number of Booking Assigned: %d (%.2f%%)\n",
             stat->accepted.size,
             (double)stat->accepted.size / received_cnt * 100.0
         );
 
-        printf("         Total Number of Booking Rejected: %d (%.2f%%)\n",
+        fprintf(stream, "         Total Number of Booking Rejected: %d (%.2f%%)\n",
             stat->rejected.size,
             (double)stat->rejected.size / received_cnt* 100.0
         );
     } else {
-        printf("         No Bookings are Received Currently.\n");
+        fprintf(stream, "         No Bookings are Received Currently.\n");
     }
 
-    printf("\n");
+    fprintf(stream, "\n");
 
 
     // Utilization of Time Slot
 
-    double rate_parking = 0.0;
-    double rate_battery_cable = 0.0;
-    double rate_locker_umbrella = 0.0;
-    double rate_inflation_service_valet_parking = 0.0;
+    fprintf(stream, "         Utilization of Time Slot:\n");
+    for (unsigned r = 0; r < resource_count(); r++) {
+        const Resource* res = resource_get(r);
+        double rate = tracker_utilization(tracker, r);
+        for (unsigned d = 0; d < res->n_devices; d++) {
+            char label[RESOURCE_NAME_LEN + 1];
+            snprintf(label, sizeof(label), "%s:", res->devices[d]);
+            fprintf(stream, "               %-19s- %.2f%%\n", label, rate * 100.00);
+        }
+    }
 
-    Vector *accepted = &stat->accepted;
-    int size = accepted->size;
-    for (int i = 0; i < size; i++) {
-        Request* req = &accepted->data[i];
-        int duration = req->duration;
+    fprintf(stream, "\n");
 
-        if (req->parking) { rate_parking += duration; }
-        if (req->essential & 0b100) { rate_battery_cable += duration; }
-        if (req->essential & 0b010) { rate_locker_umbrella += duration; }
-        if (req->essential & 0b001) { rate_inflation_service_valet_parking += duration; }
-    }
+    fprintf(stream, "         Invalid request(s) made: %d\n", invalid_cnt);
+
+    fprintf(stream, "\n");
+}
 
-    rate_parking /= (TOTAL_MINUTES * 10);
-    rate_battery_cable /= (TOTAL_MINUTES * 3);
-    rate_locker_umbrella /= (TOTAL_MINUTES * 3);
-    rate_inflation_service_valet_parking /= (TOTAL_MINUTES * 3);
 
-    printf("         Utilization of Time Slot:\n");
-    printf("               Parking:           - %.2f%%\n", rate_parking * 100.00);
-    printf("               Battery:           - %.2f%%\n", rate_battery_cable * 100.00);
-    printf("               Cable:             - %.2f%%\n", rate_battery_cable * 100.00);
-    printf("               Locker:            - %.2f%%\n", rate_locker_umbrella * 100.00);
-    printf("               Umbrella:          - %.2f%%\n", rate_locker_umbrella * 100.00);
-    printf("               Inflation Service: - %.2f%%\n", rate_inflation_service_valet_parking * 100.00);
-    printf("               Valet Parking:     - %.2f%%\n", rate_inflation_service_valet_parking * 100.00);
+// The rows of a booking vector grouped by member, each group in vector order:
+// rows[first[m] .. first[m + 1]) are those of member 'A' + m.
+typedef struct MemberRows {
+    int* rows;
+    int capacity;
+    int first[MEMBERS_CNT + 1];
+} MemberRows;
+
+// Groups the bookings by member in one pass (a counting sort), reusing buckets->rows.
+static void bucket_by_member(const Vector* bookings, MemberRows* buckets) {
+    int count[MEMBERS_CNT] = {0};
+    for (int i = 0; i < bookings->size; i++) {
+        const int m = (int)bookings->data[i].member - 'A';
+        if (m >= 0 && m < MEMBERS_CNT) count[m]++;
+    }
 
-    printf("\n");
+    buckets->first[0] = 0;
+    for (int m = 0; m < MEMBERS_CNT; m++) buckets->first[m + 1] = buckets->first[m] + count[m];
+    if (buckets->first[MEMBERS_CNT] > buckets->capacity) {
+        int* grown = realloc(buckets->rows, (size_t)buckets->first[MEMBERS_CNT] * sizeof(int));
+        if (grown == NULL) exit(1);
+        buckets->rows = grown;
+        buckets->capacity = buckets->first[MEMBERS_CNT];
+    }
 
-    printf("         Invalid request(s) made: %d\n", invalid_cnt);
+    int next[MEMBERS_CNT];
+    memcpy(next, buckets->first, sizeof(next));
+    for (int i = 0; i < bookings->size; i++) {
+        const int m = (int)bookings->data[i].member - 'A';
+        if (m >= 0 && m < MEMBERS_CNT) buckets->rows[next[m]++] = i;
+    }
+}
 
-    printf("\n");
+// The device labels of every resource a booking needs besides parking itself, in registry order.
+static int booking_devices(const Request* req, const char* devices[MAX_RESOURCES * MAX_DEVICES]) {
+    int devices_cnt = 0;
+    ResourceMask essentials = req->resources & ~RESOURCE_BIT(resource_parking());
+    for (ResourceMask m = essentials; m; m &= m - 1) {
+        const Resource* res = resource_get(resource_mask_first(m));
+        for (unsigned d = 0; d < res->n_devices; d++) {
+            devices[devices_cnt++] = res->devices[d];
+        }
+    }
+    return devices_cnt;
 }
 
+// Prints one row of the schedule table: date, start, end, type, then one device per line.
+static void print_booking(const Request* req) {
+    out_date(req->start);
+    out_padded("", DATE_LEN - (DATE_STRING_LEN - 1) + 1);
+    out_clock(req->start);
+    out_padded("", START_LEN - 5 + 1);
+    out_clock(req->start + req->duration);
+    out_padded("", END_LEN - 5 + 1);
+    out_padded(get_request_typename(req), TYPE_LEN);
+    out_char(' ');
+
+    const char* devices[MAX_RESOURCES * MAX_DEVICES];
+    const int devices_cnt = booking_devices(req, devices);
+    if (!devices_cnt) {
+        out_padded("*", DEVICE_LEN);
+        out_str(" \n");
+    }
+    for (int k = 0; k < devices_cnt; k++) {
+        if (k > 0) out_padded("", DATE_LEN + START_LEN + END_LEN + TYPE_LEN + 4);
+        out_padded(devices[k], DEVICE_LEN);
+        out_str(" \n");
+    }
+}
 
 /**
- * This function prints the requests of each member.
- * @param member_name The name of the member (not the full name, only 'A', 'B', 'C', 'D', or 'E').
- * @param stat_vector The state vector. This can be only stat->accepted or stat->rejected.
- * @param records_cnt The records made by the member.
- * @param print Print the schedule tables or calculate records_cnt only.
+ * This function prints the table of the bookings of one member.
+ * @param bookings The bookings. This can be only stat->accepted or stat->rejected.
+ * @param buckets The bookings grouped by member (see bucket_by_member()).
+ * @param member The index of the member (0 for 'A').
  */
-void
-process_member(const char member_name, const Vector* stat_vector, int* records_cnt, const bool print) {
-    for (int j = 0; j < stat_vector->size; j++) {
-        const Request* curreq = &stat_vector->data[j];
-
-        if (curreq->member == member_name) {
-
-            if (!print) {
-                (*records_cnt)++;
-                continue;
-            }
-
-            if ((*records_cnt) == 0) {
-                print_header();
-            }
-
-            (*records_cnt)++;
+static void print_member(const Vector* bookings, const MemberRows* buckets, int member) {
+    if (buckets->first[member] == buckets->first[member + 1]) {
+        print_no_record();
+        return;
+    }
+    print_header();
+    for (int i = buckets->first[member]; i < buckets->first[member + 1]; i++) {
+        print_booking(&bookings->data[buckets->rows[i]]);
+    }
+}
 
-            char* date_string       = get_date_string(curreq);
-            char* start_string      = get_start_string(curreq);
-            char* end_string        = get_end_string(curreq);
 
-            char* date_adjusted     = adjust_string(date_string, DATE_LEN);
-            char* start_adjusted    = adjust_string(get_start_string(curreq), START_LEN);
-            char* end_adjusted      = adjust_string(get_end_string(curreq), END_LEN);
-            char* type_adjusted     = adjust_string(get_request_typename(curreq), TYPE_LEN);
+// Numbers the slots of every resource the accepted bookings use, which only succeeds if no resource
+// is overbooked at any minute. Aborts otherwise. TRACKER_COUNTING relies on this numbering existing.
+// Also checks the tracker's busy counters against the accepted bookings.
+static void check_slots(const char* algo_name, const Vector* accepted, const Tracker* tracker) {
+    int* slots = malloc((size_t)(accepted->size + 1) * sizeof(int));
+    long long busy[MAX_RESOURCES] = {0};
+    for (int i = 0; i < accepted->size; i++) {
+        const Request* req = &accepted->data[i];
+        for (ResourceMask m = req->resources; m; m &= m - 1) busy[resource_mask_first(m)] += req->duration;
+    }
+    for (unsigned r = 0; r < resource_count(); r++) {
+        if (!assign_slots(accepted, r, slots)) {
+            fprintf(stderr, "%s overbooked %s\n", algo_name, resource_get(r)->name);
+            abort();
+        }
+        if (busy[r] != tracker->busy[r]) {
+            fprintf(stderr, "%s counted %lld busy minutes of %s, expected %lld\n",
+                    algo_name, tracker->busy[r], resource_get(r)->name, busy[r]);
+            abort();
+        }
+    }
+    free(slots);
+}
 
-            printf("%s ", date_adjusted);
-            printf("%s ", start_adjusted);
-            printf("%s ", end_adjusted);
-            printf("%s ", type_adjusted);
 
-            free(date_adjusted);
-            free(start_adjusted);
-            free(end_adjusted);
-            free(type_adjusted);
+static void print_bookings(FILE* stream, const char* algo_name, const Statistics* stat) {
+    static MemberRows buckets;
+    out_begin(stream);
 
-            free(date_string);
-            free(start_string);
-            free(end_string);
+    out_str("*** Parking Booking - ACCEPTED / ");
+    out_str(algo_name);
+    out_str(" ***\n\n");
 
+    bucket_by_member(&stat->accepted, &buckets);
+    for (int i = 0; i < MEMBERS_CNT; i++) {
+        out_str("Member_");
+        out_char((char)('A' + i));
+        out_str(" has the following bookings:\n");
 
-            // Print the devices
+        print_member(&stat->accepted, &buckets, i);
 
-            bool is_battery_cable                       = curreq->essential & 0b100;
-            bool is_locker_umbrella                     = curreq->essential & 0b010;
-            bool is_inflationservice_valetparking       = curreq->essential & 0b001;
+        if (i < MEMBERS_CNT - 1) {
+            print_divider();
+        }
+    }
 
-            int essential_cnt = 0;
-            char *essential_names[6];
 
-            if (is_battery_cable) {
-                essential_names[essential_cnt++] = "Battery";
-                essential_names[essential_cnt++] = "Cable";
-            }
+    out_str("\n*** Parking Booking - REJECTED / ");
+    out_str(algo_name);
+    out_str(" ***\n\n");
 
-            if (is_locker_umbrella) {
-                essential_names[essential_cnt++] = "Locker";
-                essential_names[essential_cnt++] = "Umbrella";
-            }
+    bucket_by_member(&stat->rejected, &buckets);
+    for (int i = 0; i < MEMBERS_CNT; i++) {
+        out_str("Member_");
+        out_char((char)('A' + i));
+        out_str(" (there are ");
+        out_int(buckets.first[i + 1] - buckets.first[i]);
+        out_str(" bookings rejected):\n");
 
-            if (is_inflationservice_valetparking) {
-                essential_names[essential_cnt++] = "Inflation Service";
-                essential_names[essential_cnt++] = "Valet Parking";
-            }
+        print_member(&stat->rejected, &buckets, i);
 
-            if (!essential_cnt) {
-                char* asterisk_adjusted = adjust_string("*", DEVICE_LEN);
-                printf("%s \n", asterisk_adjusted);
-                free(asterisk_adjusted);
-            } else {
-                char* essential_name_adjusted = adjust_string(essential_names[0], DEVICE_LEN);
-                printf("%s \n", essential_name_adjusted);
-                free(essential_name_adjusted);
-
-                for (int k = 1; k < essential_cnt; k++) {
-                    printf("                                             ");
-                    essential_name_adjusted = adjust_string(essential_names[k], DEVICE_LEN);
-                    printf("%s \n", essential_name_adjusted);
-                    free(essential_name_adjusted);
-                }
-            }
+        if (i < MEMBERS_CNT - 1) {
+            print_divider();
         }
     }
+
+    print_end();
+    out_flush();
 }
 
 
-/**
- * This function runs a scheduler and prints the booking information under that scheduling algorithm.
- */
-void
-schedule_and_print_bookings_single_algo(
-    int pipe_ptoc[2], int pipe_ctop[2],
-    char* algo_name, Vector* queue, const int invalid_cnt
-) {
+/* MACHINE-READABLE FORMATS */
 
-    // Run the Scheduler
+// The type of a booking, as the machine-readable formats name it.
+static const char* booking_type_name(const Request* req) {
+    static const char* names[4] = {"Event", "Reservation", "Parking", "Essentials"};
+    return req->priority < 4 ? names[req->priority] : "(Error)";
+}
 
-    Tracker* tracker = malloc(sizeof(Tracker));
-    Statistics* stat = malloc(sizeof(Statistics));
+static void out_json_string(const char* str) {
+    out_char('"');
+    for (; *str; str++) {
+        const unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            out_char('\\');
+            out_char((char)c);
+        } else if (c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            out_str("\\u00");
+            out_char(hex[c >> 4]);
+            out_char(hex[c & 15]);
+        } else {
+            out_char((char)c);
+        }
+    }
+    out_char('"');
+}
 
-    init_tracker(tracker);
-    init_statistics(stat);
+// algorithm,status,order,member,date,start,end,duration,type,devices
+static void print_csv_row(const char* algo_name, const char* status, const Request* req) {
+    out_str(algo_name);
+    out_char(',');
+    out_str(status);
+    out_char(',');
+    out_int(req->order);
+    out_char(',');
+    out_char((char)req->member);
+    out_char(',');
+    out_date(req->start);
+    out_char(',');
+    out_clock(req->start);
+    out_char(',');
+    out_clock(req->start + req->duration);
+    out_char(',');
+    out_int(req->duration);
+    out_char(',');
+    out_str(booking_type_name(req));
+    out_char(',');
+
+    // the device labels, separated by ';', between double quotes (doubled inside)
+    const char* devices[MAX_RESOURCES * MAX_DEVICES];
+    const int devices_cnt = booking_devices(req, devices);
+    out_char('"');
+    for (int k = 0; k < devices_cnt; k++) {
+        if (k > 0) out_char(';');
+        for (const char* c = devices[k]; *c; c++) {
+            if (*c == '"') out_char('"');
+            out_char(*c);
+        }
+    }
+    out_str("\"\n");
+}
 
-    if (strcmp(algo_name, "FCFS") == 0) {
-        run_fcfs(queue, stat, tracker);
-    } else if (strcmp(algo_name, "PRIO") == 0) {
-        run_prio(queue, stat, tracker);
-    } else if (strcmp(algo_name, "OPTI") == 0) {
-        run_opti(queue, stat, tracker);
+static void print_ndjson_row(const char* algo_name, const char* status, const Request* req) {
+    out_str("{\"algorithm\":\"");
+    out_str(algo_name);
+    out_str("\",\"status\":\"");
+    out_str(status);
+    out_str("\",\"order\":");
+    out_int(req->order);
+    out_str(",\"member\":\"");
+    out_char((char)req->member);
+    out_str("\",\"date\":\"");
+    out_date(req->start);
+    out_str("\",\"start\":\"");
+    out_clock(req->start);
+    out_str("\",\"end\":\"");
+    out_clock(req->start + req->duration);
+    out_str("\",\"duration\":");
+    out_int(req->duration);
+    out_str(",\"type\":\"");
+    out_str(booking_type_name(req));
+    out_str("\",\"devices\":[");
+    const char* devices[MAX_RESOURCES * MAX_DEVICES];
+    const int devices_cnt = booking_devices(req, devices);
+    for (int k = 0; k < devices_cnt; k++) {
+        if (k > 0) out_char(',');
+        out_json_string(devices[k]);
     }
+    out_str("]}\n");
+}
 
-    printf("\n");
+static void print_binary_row(Algorithm algo, bool accepted, const Request* req) {
+    const BookingRecord record = {
+        .order = req->order,
+        .resources = req->resources,
+        .start = (int32_t)req->start,
+        .duration = (int32_t)req->duration,
+        .member = (uint8_t)req->member,
+        .priority = (uint8_t)req->priority,
+        .algorithm = (uint8_t)algo,
+        .accepted = accepted,
+    };
+    memcpy(out_reserve(sizeof(record)), &record, sizeof(record));
+    out.size += sizeof(record);
+}
 
+// Streams every booking of stat in a machine-readable format: the accepted ones, then the rejected
+// ones, each in the order the algorithm decided on them.
+static void print_booking_rows(FILE* stream, Algorithm algo, const Statistics* stat, OutputFormat format) {
+    const char* algo_name = algorithm_name(algo);
+    out_begin(stream);
+    for (int pass = 0; pass < 2; pass++) {
+        const bool accepted = pass == 0;
+        const Vector* bookings = accepted ? &stat->accepted : &stat->rejected;
+        const char* status = accepted ? "accepted" : "rejected";
+        for (int i = 0; i < bookings->size; i++) {
+            const Request* req = &bookings->data[i];
+            switch (format) {
+                case OUTPUT_CSV:
+                    print_csv_row(algo_name, status, req);
+                    break;
+                case OUTPUT_NDJSON:
+                    print_ndjson_row(algo_name, status, req);
+                    break;
+                case OUTPUT_BINARY:
+                    print_binary_row(algo, accepted, req);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    out_flush();
+}
 
-    // Print the bookings
+// What a format writes before the rows of the first algorithm.
+static void print_stream_prologue(FILE* stream, OutputFormat format) {
+    if (format == OUTPUT_CSV) {
+        fprintf(stream, "algorithm,status,order,member,date,start,end,duration,type,devices\n");
+    } else if (format == OUTPUT_BINARY) {
+        BookingStreamHeader header = {
+            .magic = BOOKING_STREAM_MAGIC,
+            .version = BOOKING_STREAM_VERSION,
+            .record_size = sizeof(BookingRecord),
+            .first_day = horizon_start_day(),
+            .resource_cnt = resource_count(),
+        };
+        fwrite(&header, sizeof(header), 1, stream);
+    }
+}
 
+bool parse_output_format(const char* name, OutputFormat* format) {
+    if (name[0] == '\0' || compare(name, "table")) *format = OUTPUT_TABLE;
+    else if (compare(name, "csv")) *format = OUTPUT_CSV;
+    else if (compare(name, "ndjson") || compare(name, "json")) *format = OUTPUT_NDJSON;
+    else if (compare(name, "binary")) *format = OUTPUT_BINARY;
+    else if (compare(name, "summary")) *format = OUTPUT_SUMMARY;
+    else return false;
+    return true;
+}
 
-    PipeMessageType buffer;
+// stdout for "", else the file at path, to append to. NULL if it cannot be opened.
+static FILE* open_output(const char* path) {
+    return path[0] == '\0' ? stdout : fopen(path, "ab");
+}
 
-        (void)read(pipe_ptoc[0], &buffer, sizeof(PipeMessageType));
+static void close_output(FILE* stream) {
+    if (stream == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(stream);
+    }
+}
 
 
-    if (buffer == PRINT_BOOKINGS) {
+// What the parent sends after PRINT_BOOKINGS or PRINT_REPORT.
+typedef struct PrintRequest {
+    OutputFormat format;
+    char path[ARG_LEN];     // "" for stdout
+} PrintRequest;
 
-        printf("*** Parking Booking - ACCEPTED / %s ***\n\n", algo_name);
+// What the parent sends after SYNC, followed by the requests the worker has not been sent yet.
+typedef struct SyncHeader {
+    int count;
+    int invalid_cnt;
+} SyncHeader;
 
-        for (int i = 0; i < MEMBERS_CNT; i++) {
-            const char member_name = (char)('A' + i);
-            printf("Member_%c has the following bookings:\n", member_name);
+/**
+ * This function runs a scheduler and prints the booking information under that scheduling algorithm,
+ * for every printBookings, until the parent sends DONE or closes the pipe.
+ */
+static void schedule_and_print_bookings_single_algo(int ptoc, int ctop, Algorithm algo) {
+    const char* algo_name = algorithm_name(algo);
+    Schedule schedule;
+    schedule_init(&schedule, algo);
+    int invalid_cnt = 0;
 
-            int records_cnt = 0;
-            process_member(member_name, &stat->accepted, &records_cnt, true);
+    PipeMessageType buffer;
+    bool running = true;
+    while (running && pipe_read(ptoc, &buffer, sizeof(PipeMessageType))) {
+        switch (buffer) {
+            case SYNC: {
+                // Run the Scheduler, if there are new requests
+                SyncHeader header;
+                Vector* queue = &schedule.queue;
+                if (!pipe_read(ptoc, &header, sizeof(SyncHeader)) || header.count < 0) {
+                    running = false;
+                    break;
+                }
+                vector_reserve(queue, queue->size + header.count);
+                if (!pipe_read(ptoc, queue->data + queue->size, (size_t)header.count * sizeof(Request))) {
+                    running = false;
+                    break;
+                }
+                queue->size += header.count;
+                invalid_cnt = header.invalid_cnt;
 
-            if (!records_cnt) {
-                print_no_record();
+                schedule_update(&schedule);
+                if (schedule.tracker.backend == TRACKER_DIFF || schedule.tracker.backend == TRACKER_COUNTING) {
+                    check_slots(algo_name, &schedule.stats.accepted, &schedule.tracker);
+                }
+                break;
             }
-
-            if (i < MEMBERS_CNT - 1) {
-                print_divider();
+            case PRINT_BOOKINGS:
+            case PRINT_REPORT: {
+                PrintRequest request;
+                if (!pipe_read(ptoc, &request, sizeof(PrintRequest))) {
+                    running = false;
+                    break;
+                }
+                request.path[ARG_LEN - 1] = '\0';
+                FILE* stream = open_output(request.path);
+                if (stream != NULL && buffer == PRINT_REPORT) {
+                    print_algorithm_report(stream, algo_name, &schedule.stats, &schedule.tracker, invalid_cnt);
+                } else if (stream != NULL && request.format == OUTPUT_TABLE) {
+                    fprintf(stream, "\n");
+                    print_bookings(stream, algo_name, &schedule.stats);
+                } else if (stream != NULL) {
+                    print_booking_rows(stream, algo, &schedule.stats, request.format);
+                }
+                if (stream != NULL) close_output(stream);  // before the parent prints anything else
+                pipe_write(ctop, &(PipeMessageType){DONE}, sizeof(PipeMessageType));
+                break;
             }
+            default:
+                running = false;
+                break;
         }
+    }
 
+    schedule_free(&schedule);
+}
 
-        printf("\n*** Parking Booking - REJECTED / %s ***\n\n", algo_name);
-
-        for (int i = 0; i < MEMBERS_CNT; i++) {
-            const char member_name = (char)('A' + i);
-
-            int records_cnt = 0;
-            process_member(member_name, &stat->rejected, &records_cnt, false);
-
-            printf("Member_%c (there are %d bookings rejected):\n", member_name, records_cnt);
-            records_cnt = 0;
 
-            process_member(member_name, &stat->rejected, &records_cnt, true);
+// A long-lived process running one scheduling algorithm, started by the first printBookings that
+// selects it. It keeps its schedule between prints and is only sent the requests added since.
+typedef struct SchedulerWorker {
+    bool started;
+    pid_t pid;
+    int ptoc;       // parent to child, write end
+    int ctop;       // child to parent, read end
+    int synced;     // requests of the queue sent so far
+} SchedulerWorker;
+
+static SchedulerWorker workers[ALGO_COUNT];
+static pid_t workers_owner;    // the process that started them, not a fork of it
+
+// Forks the worker of algo, which inherits the resources, horizon and options parsed so far.
+static bool start_worker(Algorithm algo) {
+    if (workers_owner != getpid()) {
+        // a write to a dead worker must fail with EPIPE instead of killing us
+        signal(SIGPIPE, SIG_IGN);
+        workers_owner = getpid();
+    }
 
-            if (!records_cnt) {
-                print_no_record();
-            }
+    int ptoc[2], ctop[2];
+    if (pipe(ptoc) < 0) return false;
+    if (pipe(ctop) < 0) {
+        close(ptoc[0]);
+        close(ptoc[1]);
+        return false;
+    }
 
-            if (i < MEMBERS_CNT - 1) {
-                print_divider();
-            }
+    fflush(stdout);  // or the worker would flush our pending output again on exit
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(ptoc[0]);
+        close(ptoc[1]);
+        close(ctop[0]);
+        close(ctop[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(ptoc[1]); // No need to write to ptoc.
+        close(ctop[0]); // No need to read from ctop.
+        signal(SIGPIPE, SIG_DFL);
+        for (int a = 0; a < ALGO_COUNT; a++) {
+            if (!workers[a].started) continue;
+            close(workers[a].ptoc);
+            close(workers[a].ctop);
+            workers[a].started = false;
         }
 
-        print_end();
+        schedule_and_print_bookings_single_algo(ptoc[0], ctop[1], algo);
 
+        close(ptoc[0]);
+        close(ctop[1]);
+        exit(0);
     }
 
-    (void)write(pipe_ctop[1], &(PipeMessageType){DONE}, sizeof(PipeMessageType));
+    close(ptoc[0]);
+    close(ctop[1]);
+    workers[algo] = (SchedulerWorker){.started = true, .pid = pid, .ptoc = ptoc[1], .ctop = ctop[0], .synced = 0};
+    return true;
+}
 
-    (void)read(pipe_ptoc[0], &buffer, sizeof(PipeMessageType));
+// Reaps a worker whose pipe broke and reports how it ended. The next print that selects its algorithm
+// starts it again and sends it the whole queue.
+static void lose_worker(Algorithm algo) {
+    SchedulerWorker* worker = &workers[algo];
+    int status = 0;
+    close(worker->ptoc);
+    close(worker->ctop);
+    pid_t pid = waitpid(worker->pid, &status, 0);
+    worker->started = false;
+
+    fflush(stdout);
+    if (pid == worker->pid && WIFSIGNALED(status)) {
+        printf("Error: The %s scheduler was killed by signal %d (%s); it restarts at the next print\n",
+               algorithm_name(algo), WTERMSIG(status), strsignal(WTERMSIG(status)));
+    } else if (pid == worker->pid && WIFEXITED(status)) {
+        printf("Error: The %s scheduler exited with status %d; it restarts at the next print\n",
+               algorithm_name(algo), WEXITSTATUS(status));
+    } else {
+        printf("Error: The %s scheduler stopped responding; it restarts at the next print\n", algorithm_name(algo));
+    }
+}
 
-    if (buffer == PRINT_REPORT) {
-        print_algorithm_report(algo_name, stat, invalid_cnt);
-        (void)write(pipe_ctop[1], &(PipeMessageType){DONE}, sizeof(PipeMessageType));
+// Sends the worker the requests of queue it has not seen yet, which it schedules right away.
+// @return false if the worker is gone
+static bool sync_worker(SchedulerWorker* worker, const Vector* queue, int invalid_cnt) {
+    SyncHeader header = {queue->size - worker->synced, invalid_cnt};
+    if (pipe_write(worker->ptoc, &(PipeMessageType){SYNC}, sizeof(PipeMessageType)) &&
+        pipe_write(worker->ptoc, &header, sizeof(SyncHeader)) &&
+        pipe_write(worker->ptoc, queue->data + worker->synced, (size_t)header.count * sizeof(Request))) {
+        worker->synced = queue->size;
+        return true;
     }
+    return false;
+}
 
+// Tells the worker to print, and waits until it is done.
+// @return false if the worker is gone
+static bool ask_worker(const SchedulerWorker* worker, PipeMessageType message, const PrintRequest* request) {
+    PipeMessageType buffer;
+    fflush(stdout);
+    return pipe_write(worker->ptoc, &message, sizeof(PipeMessageType)) &&
+           pipe_write(worker->ptoc, request, sizeof(PrintRequest)) &&
+           pipe_read(worker->ctop, &buffer, sizeof(PipeMessageType));
 }
 
-void schedule_and_print_bookings (char *algo, Vector* queue, const int invalid_cnt) {
+void schedule_and_print_bookings(const char* algo, const char* format, const char* path, const Vector* queue,
+                                 const int invalid_cnt) {
 
     bool is_fcfs = strcmp(algo, "fcfs") == 0 || strcmp(algo, "all") == 0 || strcmp(algo, "ALL") == 0;
     bool is_prio = strcmp(algo, "prio") == 0 || strcmp(algo, "all") == 0 || strcmp(algo, "ALL") == 0;
@@ -402,154 +765,87 @@ void schedule_and_print_bookings (char *algo, Vector* queue, const int invalid_c
 
     if (!is_fcfs && !is_prio && !is_opti && !is_all) {
         printf("Unsupported scheduling algorithm: \"%s\".\n", algo);
+        return;
     }
 
-
-    // Build pipes.
-
-    int pipe_ptoc[3][2], pipe_ctop[3][2];
-
-    // FCFS
-    if (is_fcfs) {
-        pipe(pipe_ptoc[0]);     // FCFS scheduler, parent to child
-        pipe(pipe_ctop[0]);     // FCFS scheduler, child to parent
-
-        // child process
-        const pid_t pid = fork();
-        if (pid < 0) { perror("fork"); }
-        if (pid == 0) {
-            close(pipe_ptoc[0][1]); // No need to write to ptoc.
-            close(pipe_ctop[0][0]); // No need to read from ctop.
-
-            schedule_and_print_bookings_single_algo(
-                pipe_ptoc[0], pipe_ctop[0],
-                "FCFS", queue, invalid_cnt
-            );
-
-            close(pipe_ptoc[0][0]);
-            close(pipe_ctop[0][1]);
-
-            exit(0);
-        }
-
-        // parent process
-        close(pipe_ptoc[0][0]);
-        close(pipe_ctop[0][1]);
+    PrintRequest request = {.format = OUTPUT_TABLE};
+    if (!parse_output_format(format, &request.format)) {
+        printf("Unsupported output format: \"%s\".\n", format);
+        return;
     }
+    snprintf(request.path, ARG_LEN, "%s", path);
 
-    // PRIO
-    if (is_prio) {
-        pipe(pipe_ptoc[1]);     // PRIO scheduler, parent to child
-        pipe(pipe_ctop[1]);     // PRIO scheduler, child to parent
-
-        // child process
-        const pid_t pid = fork();
-        if (pid < 0) { perror("fork"); }
-        if (pid == 0) {
-            close(pipe_ptoc[1][1]); // No need to write to ptoc.
-            close(pipe_ctop[1][0]); // No need to read from ctop.
 
-            schedule_and_print_bookings_single_algo(
-                pipe_ptoc[1], pipe_ctop[1],
-                "PRIO", queue, invalid_cnt
-            );
+    // Replace the output file, and start it as its format requires.
 
-            close(pipe_ptoc[1][0]);
-            close(pipe_ctop[1][1]);
-
-            exit(0);
-        }
-
-        // parent process
-        close(pipe_ptoc[1][0]);
-        close(pipe_ctop[1][1]);
+    FILE* stream = path[0] == '\0' ? stdout : fopen(path, "wb");
+    if (stream == NULL) {
+        printf("Error: Cannot write the bookings to %s\n", path);
+        return;
     }
+    print_stream_prologue(stream, request.format);
+    close_output(stream);
 
-    // OPTI
-    if (is_opti) {
-        pipe(pipe_ptoc[2]);     // OPTI scheduler, parent to child
-        pipe(pipe_ctop[2]);     // OPTI scheduler, child to parent
 
-        // child process
-        const pid_t pid = fork();
-        if (pid < 0) { perror("fork"); }
-        if (pid == 0) {
-            close(pipe_ptoc[2][1]); // No need to write to ptoc.
-            close(pipe_ctop[2][0]); // No need to read from ctop.
+    // Send every selected scheduler the new requests first, so that they run at the same time.
 
-            schedule_and_print_bookings_single_algo(
-                pipe_ptoc[2], pipe_ctop[2],
-                "OPTI", queue, invalid_cnt
-            );
+    bool selected[ALGO_COUNT] = {is_fcfs, is_prio, is_opti};
 
-            close(pipe_ptoc[2][0]);
-            close(pipe_ctop[2][1]);
-
-            exit(0);
+    for (int a = 0; a < ALGO_COUNT; a++) {
+        if (!selected[a]) continue;
+        if (!workers[a].started && !start_worker((Algorithm)a)) {
+            selected[a] = false;
+            continue;
+        }
+        if (!sync_worker(&workers[a], queue, invalid_cnt)) {
+            lose_worker((Algorithm)a);
+            selected[a] = false;
         }
-
-        // parent process
-        close(pipe_ptoc[2][0]);
-        close(pipe_ctop[2][1]);
     }
 
 
-    // Tell the children to print the bookings.
-
-    PipeMessageType buffer;
-
-    if (is_fcfs) {
-        (void)write(pipe_ptoc[0][1], &(PipeMessageType){PRINT_BOOKINGS}, sizeof(PipeMessageType));
-        (void)read(pipe_ctop[0][0], &buffer, sizeof(PipeMessageType));
-    }
+    // Tell the schedulers to print the bookings.
 
-    if (is_prio) {
-        (void)write(pipe_ptoc[1][1], &(PipeMessageType){PRINT_BOOKINGS}, sizeof(PipeMessageType));
-        (void)read(pipe_ctop[1][0], &buffer, sizeof(PipeMessageType));
-    }
-
-    if (is_opti) {
-        (void)write(pipe_ptoc[2][1], &(PipeMessageType){PRINT_BOOKINGS}, sizeof(PipeMessageType));
-        printf("The OPTI scheduler may take some time to run, please be patient!\n\n");
-        (void)read(pipe_ctop[2][0], &buffer, sizeof(PipeMessageType));
+    if (request.format != OUTPUT_SUMMARY) {
+        for (int a = 0; a < ALGO_COUNT; a++) {
+            if (!selected[a]) continue;
+            if (a == ALGO_OPTI && request.format == OUTPUT_TABLE) {
+                printf("The OPTI scheduler may take some time to run, please be patient!\n\n");
+            }
+            if (!ask_worker(&workers[a], PRINT_BOOKINGS, &request)) {
+                lose_worker((Algorithm)a);
+                selected[a] = false;
+            }
+        }
     }
 
 
     // Print the summary report (if applicable)
 
-    if (is_all) {
-        printf("*** Parking Booking Manager - Summary Report ***\n\n");
-        printf("Performance:\n\n");
-
-        (void)write(pipe_ptoc[0][1], &(PipeMessageType){PRINT_REPORT}, sizeof(PipeMessageType));
-        (void)read(pipe_ctop[0][0], &buffer, sizeof(PipeMessageType));
+    if ((is_all && request.format == OUTPUT_TABLE) || request.format == OUTPUT_SUMMARY) {
+        if ((stream = open_output(path)) == NULL) return;
+        fprintf(stream, "*** Parking Booking Manager - Summary Report ***\n\n");
+        fprintf(stream, "Performance:\n\n");
+        close_output(stream);
 
-        (void)write(pipe_ptoc[1][1], &(PipeMessageType){PRINT_REPORT}, sizeof(PipeMessageType));
-        (void)read(pipe_ctop[1][0], &buffer, sizeof(PipeMessageType));
-
-        (void)write(pipe_ptoc[2][1], &(PipeMessageType){PRINT_REPORT}, sizeof(PipeMessageType));
-        (void)read(pipe_ctop[2][0], &buffer, sizeof(PipeMessageType));
-
-        printf("\n");
-    }
-
-
-    // Close all pipe ends.
-
-    if (is_fcfs) {
-        close(pipe_ptoc[0][1]);
-        close(pipe_ctop[0][0]);
-    }
+        for (int a = 0; a < ALGO_COUNT; a++) {
+            if (selected[a] && !ask_worker(&workers[a], PRINT_REPORT, &request)) lose_worker((Algorithm)a);
+        }
 
-    if (is_prio) {
-        close(pipe_ptoc[1][1]);
-        close(pipe_ctop[1][0]);
+        if ((stream = open_output(path)) == NULL) return;
+        fprintf(stream, "\n");
+        close_output(stream);
     }
+}
 
-    if (is_opti) {
-        close(pipe_ptoc[2][1]);
-        close(pipe_ctop[2][0]);
+void stop_scheduler_workers(void) {
+    if (workers_owner != getpid()) return;  // an exiting fork must leave them alone
+    for (int a = 0; a < ALGO_COUNT; a++) {
+        if (!workers[a].started) continue;
+        pipe_write(workers[a].ptoc, &(PipeMessageType){DONE}, sizeof(PipeMessageType));
+        close(workers[a].ptoc);
+        close(workers[a].ctop);
+        waitpid(workers[a].pid, NULL, 0);
+        workers[a].started = false;
     }
-
-    wait(NULL);
 }
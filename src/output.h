@@ -9,6 +9,89 @@
 #include "vector.h"
 #include "state.h"
 
-void schedule_and_print_bookings(char *algo, Vector* queue, const int invalid_cnt);
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    DONE,               // Tell the child to exit / tell the parent the current task is done.
+    PRINT_BOOKINGS,     // Tell the child to print its bookings.
+    PRINT_REPORT,       // Tell the child to print its reports.
+    OPTI_RESULT,        // An OPTI worker reports its best schedule. See run_opti().
+    SYNC                // Send a scheduler the requests added since its last print.
+} PipeMessageType;
+
+// Writes / reads exactly len bytes, retrying short transfers. Returns false on error or EOF.
+bool pipe_write(int fd, const void* buf, size_t len);
+bool pipe_read(int fd, void* buf, size_t len);
+
+// How printBookings writes the bookings (its second argument).
+typedef enum OutputFormat {
+    OUTPUT_TABLE,       // "table" (default): per-member tables, and the summary report for "all"
+    OUTPUT_CSV,         // "csv": one line per booking, after a header line
+    OUTPUT_NDJSON,      // "ndjson" or "json": one JSON object per line and booking
+    OUTPUT_BINARY,      // "binary": a BookingStreamHeader, then one BookingRecord per booking
+    OUTPUT_SUMMARY      // "summary": only the summary report, for every selected algorithm
+} OutputFormat;
+
+/**
+ * @return false if name is not a format; "" is OUTPUT_TABLE
+ */
+bool parse_output_format(const char* name, OutputFormat* format);
+
+// The binary format starts with this header. Every field is in the byte order of the machine.
+#define BOOKING_STREAM_MAGIC    "SPMSrow"   // with its '\0', 8 bytes
+#define BOOKING_STREAM_VERSION  1u
+
+typedef struct BookingStreamHeader {
+    char magic[8];
+    uint32_t version;       // BOOKING_STREAM_VERSION
+    uint32_t record_size;   // sizeof(BookingRecord)
+    int32_t first_day;      // of the horizon, in days since 1970-01-01
+    uint32_t resource_cnt;  // bit r of BookingRecord.resources is resource r of the registry
+} BookingStreamHeader;
+
+/**
+ * One booking of the binary format. The records of each algorithm come accepted first, then
+ * rejected, each in the order the algorithm decided on them.
+ *
+ * @param order         The position of the request in the queue (starts from 1)
+ * @param resources     The resources requested, one bit per resource of the registry
+ * @param start         Minutes since the start of the horizon
+ * @param duration      Minutes
+ * @param member        'A', 'B', 'C' ...
+ * @param priority      0 (Event) ~ 3 (Essentials)
+ * @param algorithm     0 (FCFS), 1 (PRIO) or 2 (OPTI)
+ * @param accepted      1 if accepted, 0 if rejected
+ */
+typedef struct BookingRecord {
+    int32_t order;
+    uint32_t resources;
+    int32_t start;
+    int32_t duration;
+    uint8_t member;
+    uint8_t priority;
+    uint8_t algorithm;
+    uint8_t accepted;
+} BookingRecord;
+
+_Static_assert(sizeof(BookingStreamHeader) == 24 && sizeof(BookingRecord) == 20, "the binary format is fixed");
+
+/**
+ * Prints the bookings of the selected algorithms ("fcfs", "prio", "opti" or "all"), and the summary
+ * report for "all". Each algorithm runs in a worker process started by the first print that selects
+ * it, which keeps its schedule and is only sent the requests added to queue since its last print.
+ * A worker that died is reported and left out of this print, and started again by the next one.
+ * @param format    See OutputFormat
+ * @param path      File to write the output to, replacing it, or "" for stdout
+ */
+void schedule_and_print_bookings(const char* algo, const char* format, const char* path, const Vector* queue,
+                                 const int invalid_cnt);
+
+/**
+ * Tells the scheduler workers to exit, and waits for them. Registered with atexit() by main(), so it
+ * also runs on every other way out; does nothing in a forked child.
+ */
+void stop_scheduler_workers(void);
 
 #endif //OUTPUT_H
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "pagedtree.h"
+#include "segtree.h"
+#include "daypages.h"
+#include <stdlib.h>
+#include <assert.h>
+
+#define MASK_BITS   64      // bits per word of segtree_free_mask()
+
+struct PagedTree {
+    DayPages days;  // each page holds a SegTree over one day of all K instances (days.arg)
+};
+
+/* PRIVATE METHODS */
+
+static void* page_build(int start, int end, unsigned K) { return segtree_build(start, end, K); }
+static void page_destroy(void* st) { segtree_destroy(st); }
+static void page_overwrite(void* source, void* target) { segtree_overwrite(source, target); }
+
+static const DayPageOps segtree_pages = {
+    .build = page_build,
+    .destroy = page_destroy,
+    .overwrite = page_overwrite,
+};
+
+/* PUBLIC METHODS */
+
+PagedTree* pagedtree_build(int start, int end, unsigned K) {
+    PagedTree* pt = (PagedTree*)malloc(sizeof(PagedTree));
+    if (pt == NULL) return NULL;
+    if (!daypages_init(&pt->days, start, end, K, &segtree_pages)) {
+        free(pt);
+        return NULL;
+    }
+    return pt;
+}
+
+void pagedtree_destroy(PagedTree* pt) {
+    if (pt == NULL) return;
+    daypages_free(&pt->days);
+    free(pt);
+}
+
+void pagedtree_empty(PagedTree* pt) {
+    daypages_empty(&pt->days);
+}
+
+void pagedtree_range_set(PagedTree* pt, unsigned k, int l, int r, int val) {
+    DayPages* days = &pt->days;
+    assert(k < days->arg && days->start <= l && l <= r && r <= days->end && val >= 0);
+    for (unsigned i = daypages_of(days, l); i <= daypages_of(days, r); i++) {
+        if (val == 0 && daypages_get(days, i) == NULL) continue;
+        int lo = daypages_start(days, i), hi = daypages_end(days, i);
+        segtree_range_set(daypages_writable(days, i), k, l > lo ? l : lo, r < hi ? r : hi, val);
+    }
+}
+
+void pagedtree_range_query(PagedTree* pt, int l, int r, int* results) {
+    const DayPages* days = &pt->days;
+    assert(days->start <= l && l <= r && r <= days->end);
+    const unsigned K = days->arg;
+    int page_results[K];
+    for (unsigned k = 0; k < K; k++) results[k] = 0;
+    for (unsigned i = daypages_of(days, l); i <= daypages_of(days, r); i++) {
+        SegTree* st = daypages_get(days, i);
+        if (st == NULL) continue;
+        int lo = daypages_start(days, i), hi = daypages_end(days, i);
+        segtree_range_query(st, l > lo ? l : lo, r < hi ? r : hi, page_results);
+        for (unsigned k = 0; k < K; k++) {
+            results[k] = (page_results[k] > results[k]) ? page_results[k] : results[k];
+        }
+    }
+}
+
+int pagedtree_first_free(PagedTree* pt, int l, int r) {
+    const DayPages* days = &pt->days;
+    assert(days->start <= l && l <= r && r <= days->end);
+    unsigned first = daypages_of(days, l), last = daypages_of(days, r);
+    if (first == last) {
+        SegTree* st = daypages_get(days, first);
+        return st ? segtree_first_free(st, l, r) : 0;
+    }
+
+    const unsigned K = days->arg;
+    const unsigned words = (K + MASK_BITS - 1) / MASK_BITS;
+    unsigned long long mask[words], page_mask[words];
+    for (unsigned w = 0; w < words; w++) mask[w] = ~0ULL;
+    if (K % MASK_BITS) mask[words - 1] = (1ULL << (K % MASK_BITS)) - 1;
+
+    for (unsigned i = first; i <= last; i++) {
+        SegTree* st = daypages_get(days, i);
+        if (st == NULL) continue;
+        int lo = daypages_start(days, i), hi = daypages_end(days, i);
+        segtree_free_mask(st, l > lo ? l : lo, r < hi ? r : hi, page_mask);
+        unsigned long long any = 0;
+        for (unsigned w = 0; w < words; w++) any |= (mask[w] &= page_mask[w]);
+        if (!any) return -1;
+    }
+
+    for (unsigned w = 0; w < words; w++) {
+        if (mask[w]) return (int)(w * MASK_BITS) + __builtin_ctzll(mask[w]);
+    }
+    return -1;
+}
+
+void pagedtree_overwrite(PagedTree* source, PagedTree* target) {
+    assert(source && target);
+    daypages_share(&source->days, &target->days);
+}
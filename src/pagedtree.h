@@ -0,0 +1,61 @@
+#ifndef PAGEDTREE_H
+#define PAGEDTREE_H
+
+/**
+ * Opaque handle representing K parallel segment trees split into day-sized pages (daypages.h).
+ * Each page is a SegTree over one day and is only allocated when first written, so an empty
+ * day costs a NULL pointer. Pages are reference counted: pagedtree_overwrite() shares them
+ * instead of copying, and a shared page is copied by whichever side writes it first.
+ * The interface mirrors segtree.h.
+ */
+typedef struct PagedTree PagedTree;
+
+/**
+ * Creates K empty paged segment trees over [start, end]. Allocates no pages.
+ *
+ * @param start     Start index of all trees (inclusive)
+ * @param end       End index of all trees (inclusive)
+ * @param K         Number of parallel instances
+ * @return          New handle. Must be destroyed with pagedtree_destroy(). NULL on allocation failure
+ */
+PagedTree* pagedtree_build(int start, int end, unsigned K);
+
+/**
+ * Safely destroys the trees and drops their references to all pages
+ *
+ * @param pt        Handle from pagedtree_build(). No-op if NULL
+ */
+void pagedtree_destroy(PagedTree* pt);
+
+/**
+ * Resets all trees to empty state by dropping every page
+ * @param pt        Pointer to the paged tree to be emptied
+ */
+void pagedtree_empty(PagedTree* pt);
+
+/**
+ * Same as segtree_range_set(). Allocates or unshares the pages [l, r] touches.
+ * Clearing a range of a page that was never allocated is free.
+ */
+void pagedtree_range_set(PagedTree* pt, unsigned k, int l, int r, int val);
+
+/**
+ * Same as segtree_range_query(). Unallocated pages count as 0.
+ */
+void pagedtree_range_query(PagedTree* pt, int l, int r, int* results);
+
+/**
+ * Same as segtree_first_free(). Ranges spanning several pages intersect the free masks of the
+ * allocated pages.
+ */
+int pagedtree_first_free(PagedTree* pt, int l, int r);
+
+/**
+ * Makes target share every page of source. O(number of pages), no page is copied.
+ *
+ * @param source    Source paged tree to copy from
+ * @param target    Target paged tree to copy to
+ */
+void pagedtree_overwrite(PagedTree* source, PagedTree* target);
+
+#endif // PAGEDTREE_H
@@ -0,0 +1,268 @@
+#include "psegtree.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#define TAG_NONE        (-1)    // stored values are never negative, so -1 marks "no pending assignment"
+#define NO_SNAPSHOT     UINT_MAX
+#define INIT_NODES      1024u
+#define MIN_GARBAGE     4096u   // do not bother collecting arenas smaller than this
+
+// Node layout inside the arena (stride = NODE_HEAD + 2 * K ints):
+//   [LEFT] [RIGHT] [GEN] max[0 .. K) tag[0 .. K)
+// Node 0 is the shared empty subtree: no children, all maxima 0, no tags. It is never written.
+// A tag on lane k means the whole range of the node holds that value on lane k.
+#define LEFT            0
+#define RIGHT           1
+#define GEN             2
+#define NODE_HEAD       3
+
+struct PSegTree {
+    int start;
+    int end;
+    unsigned K;
+    unsigned stride;
+    int gen;                // nodes stamped with gen may be updated in place
+    PSegVersion root;       // current version
+    int* pool;
+    unsigned top;           // next free node
+    unsigned cap;           // nodes in pool
+    int* spare;             // to-space of psegtree_collect(), same capacity as pool
+    unsigned* forward;      // forwarding table of psegtree_collect(), same capacity as pool
+    unsigned live;          // nodes that survived the last collection
+    PSegVersion last_snapshot;
+    unsigned mark;          // top at the time of last_snapshot
+};
+
+/* PRIVATE METHODS */
+
+static int* node(const PSegTree* st, unsigned p) {
+    return st->pool + (size_t)p * st->stride;
+}
+
+static void reset_null(PSegTree* st) {
+    int* nd = node(st, 0);
+    memset(nd, 0, (size_t)st->stride * sizeof(int));
+    for (unsigned k = 0; k < st->K; k++) nd[NODE_HEAD + st->K + k] = TAG_NONE;
+    nd[GEN] = INT_MIN;
+}
+
+static void grow(PSegTree* st) {
+    unsigned cap = st->cap * 2;
+    size_t bytes = (size_t)cap * st->stride * sizeof(int);
+    int* pool = realloc(st->pool, bytes);
+    int* spare = realloc(st->spare, bytes);
+    unsigned* forward = realloc(st->forward, (size_t)cap * sizeof(unsigned));
+    assert(pool && spare && forward);
+    st->pool = pool;
+    st->spare = spare;
+    st->forward = forward;
+    st->cap = cap;
+}
+
+// Returns a node of the current generation holding the contents of p, copying p if it is frozen.
+static unsigned own(PSegTree* st, unsigned p) {
+    if (p != 0 && node(st, p)[GEN] == st->gen) return p;
+    if (st->top == st->cap) grow(st);
+    unsigned q = st->top++;
+    memcpy(node(st, q), node(st, p), (size_t)st->stride * sizeof(int));
+    node(st, q)[GEN] = st->gen;
+    return q;
+}
+
+// Assigns val to lane k of the child stored at slot (LEFT or RIGHT) of node p.
+static void push_child(PSegTree* st, unsigned p, int slot, unsigned k, int val) {
+    unsigned c = own(st, (unsigned)node(st, p)[slot]);
+    node(st, p)[slot] = (int)c;
+    int* nd = node(st, c);
+    nd[NODE_HEAD + k] = val;
+    nd[NODE_HEAD + st->K + k] = val;
+}
+
+static unsigned update(PSegTree* st, unsigned p, int cl, int cr, unsigned k, int l, int r, int val) {
+    const unsigned K = st->K;
+    p = own(st, p);
+    if (l <= cl && cr <= r) {
+        node(st, p)[NODE_HEAD + k] = val;
+        node(st, p)[NODE_HEAD + K + k] = val;
+        return p;
+    }
+
+    int tag = node(st, p)[NODE_HEAD + K + k];
+    if (tag != TAG_NONE) {
+        push_child(st, p, LEFT, k, tag);
+        push_child(st, p, RIGHT, k, tag);
+        node(st, p)[NODE_HEAD + K + k] = TAG_NONE;
+    }
+
+    int cm = cl + (cr - cl) / 2;
+    if (l <= cm) {
+        unsigned c = update(st, (unsigned)node(st, p)[LEFT], cl, cm, k, l, r, val);
+        node(st, p)[LEFT] = (int)c;
+    }
+    if (r > cm) {
+        unsigned c = update(st, (unsigned)node(st, p)[RIGHT], cm + 1, cr, k, l, r, val);
+        node(st, p)[RIGHT] = (int)c;
+    }
+
+    int* nd = node(st, p);
+    int left = node(st, (unsigned)nd[LEFT])[NODE_HEAD + k];
+    int right = node(st, (unsigned)nd[RIGHT])[NODE_HEAD + k];
+    nd[NODE_HEAD + k] = (left > right) ? left : right;
+    return p;
+}
+
+static void query(const PSegTree* st, unsigned p, int cl, int cr, int l, int r, int* out) {
+    const unsigned K = st->K;
+    const int* nd = node(st, p);
+    if (p == 0 || (l <= cl && cr <= r)) {
+        for (unsigned k = 0; k < K; k++) {
+            out[k] = (nd[NODE_HEAD + k] > out[k]) ? nd[NODE_HEAD + k] : out[k];
+        }
+        return;
+    }
+
+    int tmp[K];
+    for (unsigned k = 0; k < K; k++) tmp[k] = INT_MIN;
+    int cm = cl + (cr - cl) / 2;
+    if (l <= cm) query(st, (unsigned)nd[LEFT], cl, cm, l, r, tmp);
+    if (r > cm) query(st, (unsigned)nd[RIGHT], cm + 1, cr, l, r, tmp);
+
+    for (unsigned k = 0; k < K; k++) {
+        int v = (nd[NODE_HEAD + K + k] != TAG_NONE) ? nd[NODE_HEAD + K + k] : tmp[k];
+        out[k] = (v > out[k]) ? v : out[k];
+    }
+}
+
+// Copies the subtree rooted at p from the pool of st into dst, keeping shared nodes shared.
+// st->forward must be cleared over [0, st->top) before the first call.
+static unsigned evacuate(PSegTree* st, int* dst, unsigned p, unsigned* to_top) {
+    if (p == 0) return 0;
+    if (st->forward[p]) return st->forward[p];
+    unsigned q = (*to_top)++;
+    st->forward[p] = q;
+    int* nd = dst + (size_t)q * st->stride;
+    memcpy(nd, node(st, p), (size_t)st->stride * sizeof(int));
+    nd[GEN] = 0;  // frozen: every surviving node may be shared
+    unsigned left = evacuate(st, dst, (unsigned)nd[LEFT], to_top);
+    unsigned right = evacuate(st, dst, (unsigned)nd[RIGHT], to_top);
+    nd[LEFT] = (int)left;
+    nd[RIGHT] = (int)right;
+    return q;
+}
+
+/* PUBLIC METHODS */
+
+PSegTree* psegtree_build(int start, int end, unsigned K) {
+    assert(end - start + 1 > 0);
+    PSegTree* st = (PSegTree*)malloc(sizeof(PSegTree));
+    if (st == NULL) return NULL;
+    st->start = start;
+    st->end = end;
+    st->K = K;
+    st->stride = NODE_HEAD + 2 * K;
+    st->cap = INIT_NODES;
+    st->pool = malloc((size_t)st->cap * st->stride * sizeof(int));
+    st->spare = malloc((size_t)st->cap * st->stride * sizeof(int));
+    st->forward = malloc((size_t)st->cap * sizeof(unsigned));
+    if (!st->pool || !st->spare || !st->forward) {
+        psegtree_destroy(st);
+        return NULL;
+    }
+    psegtree_empty(st);
+    return st;
+}
+
+void psegtree_destroy(PSegTree* st) {
+    if (st == NULL) return;
+    free(st->pool);
+    free(st->spare);
+    free(st->forward);
+    free(st);
+}
+
+void psegtree_empty(PSegTree* st) {
+    reset_null(st);
+    st->gen = 1;
+    st->root = 0;
+    st->top = 1;
+    st->live = 1;
+    st->last_snapshot = NO_SNAPSHOT;
+    st->mark = 1;
+}
+
+void psegtree_range_set(PSegTree* st, unsigned k, int l, int r, int val) {
+    assert(k < st->K && st->start <= l && l <= r && r <= st->end && val >= 0);
+    st->root = update(st, st->root, st->start, st->end, k, l, r, val);
+}
+
+void psegtree_range_query(PSegTree* st, int l, int r, int* results) {
+    assert(st->start <= l && l <= r && r <= st->end);
+    for (unsigned k = 0; k < st->K; k++) results[k] = INT_MIN;
+    query(st, st->root, st->start, st->end, l, r, results);
+}
+
+int psegtree_first_free(PSegTree* st, int l, int r) {
+    int results[st->K];
+    psegtree_range_query(st, l, r, results);
+    for (unsigned k = 0; k < st->K; k++) {
+        if (results[k] == 0) return (int)k;
+    }
+    return -1;
+}
+
+void psegtree_overwrite(PSegTree* source, PSegTree* target) {
+    assert(source && target && source->K == target->K);
+    while (target->cap < source->top) grow(target);
+
+    memset(source->forward, 0, (size_t)source->top * sizeof(unsigned));
+    memcpy(target->pool, source->pool, (size_t)source->stride * sizeof(int));  // node 0
+    unsigned to_top = 1;
+    target->root = evacuate(source, target->pool, source->root, &to_top);
+
+    target->start = source->start;
+    target->end = source->end;
+    target->gen = 1;
+    target->top = to_top;
+    target->live = to_top;
+    target->last_snapshot = NO_SNAPSHOT;
+    target->mark = to_top;
+}
+
+PSegVersion psegtree_snapshot(PSegTree* st) {
+    st->gen++;
+    st->last_snapshot = st->root;
+    st->mark = st->top;
+    return st->root;
+}
+
+void psegtree_restore(PSegTree* st, PSegVersion version) {
+    assert(version < st->top);
+    // No snapshot was taken after last_snapshot, so nothing allocated since can still be reached.
+    if (version == st->last_snapshot) st->top = st->mark;
+    st->root = version;
+}
+
+bool psegtree_should_collect(const PSegTree* st) {
+    return st->top > MIN_GARBAGE && st->top > 2 * st->live;
+}
+
+void psegtree_collect(PSegTree* st, PSegVersion* live, unsigned n_live) {
+    memset(st->forward, 0, (size_t)st->top * sizeof(unsigned));
+    memcpy(st->spare, st->pool, (size_t)st->stride * sizeof(int));  // node 0
+    unsigned to_top = 1;
+    st->root = evacuate(st, st->spare, st->root, &to_top);
+    for (unsigned i = 0; i < n_live; i++) {
+        live[i] = evacuate(st, st->spare, live[i], &to_top);
+    }
+
+    int* tmp = st->pool;
+    st->pool = st->spare;
+    st->spare = tmp;
+    st->top = to_top;
+    st->live = to_top;
+    st->last_snapshot = NO_SNAPSHOT;
+    st->mark = to_top;
+}
@@ -0,0 +1,99 @@
+#ifndef PSEGTREE_H
+#define PSEGTREE_H
+
+#include <stdbool.h>
+
+/**
+ * Opaque handle representing K parallel persistent segment trees.
+ * Updates copy the touched path instead of writing in place once a version has been frozen,
+ * so a snapshot is a single root index and restoring it is a pointer swap.
+ * Nodes live in a generation-stamped arena: nodes of the current generation are updated in place,
+ * older ones are copied on write. Use psegtree_collect() to reclaim nodes no version can reach.
+ */
+typedef struct PSegTree PSegTree;
+
+/**
+ * A frozen version of all K trees (the root node of that version)
+ */
+typedef unsigned PSegVersion;
+
+/**
+ * Creates K parallel persistent segment trees covering [start, end]
+ *
+ * @param start     Start index of all segment trees (inclusive)
+ * @param end       End index of all segment trees (inclusive)
+ * @param K         Number of parallel segment tree instances
+ * @return          New handle. Must be destroyed with psegtree_destroy(). NULL on allocation failure
+ */
+PSegTree* psegtree_build(int start, int end, unsigned K);
+
+/**
+ * Safely destroys the trees and releases the whole arena
+ *
+ * @param st        Handle from psegtree_build(). No-op if NULL
+ */
+void psegtree_destroy(PSegTree* st);
+
+/**
+ * Resets all trees to empty state. Invalidates every version taken so far.
+ * @param st        Pointer to the segment tree to be emptied
+ */
+void psegtree_empty(PSegTree* st);
+
+/**
+ * Same as segtree_range_set(), on the current version
+ */
+void psegtree_range_set(PSegTree* st, unsigned k, int l, int r, int val);
+
+/**
+ * Same as segtree_range_query(), on the current version
+ */
+void psegtree_range_query(PSegTree* st, int l, int r, int* results);
+
+/**
+ * Same as segtree_first_free(), on the current version
+ */
+int psegtree_first_free(PSegTree* st, int l, int r);
+
+/**
+ * Overwrites target with a private copy of the current version of source
+ *
+ * @param source    Source segment tree to copy from
+ * @param target    Target segment tree to copy to
+ */
+void psegtree_overwrite(PSegTree* source, PSegTree* target);
+
+/**
+ * Freezes the current version and returns it. O(1).
+ * Later updates copy the nodes they touch, so the returned version never changes.
+ *
+ * @param st        Handle from psegtree_build()
+ * @return          The frozen version
+ */
+PSegVersion psegtree_snapshot(PSegTree* st);
+
+/**
+ * Makes a frozen version current again. O(1).
+ * Restoring the most recent snapshot also releases every node allocated after it.
+ *
+ * @param st        Handle from psegtree_build()
+ * @param version   A version returned by psegtree_snapshot() on the same tree
+ */
+void psegtree_restore(PSegTree* st, PSegVersion version);
+
+/**
+ * @return If the arena holds enough unreachable nodes for psegtree_collect() to be worthwhile
+ */
+bool psegtree_should_collect(const PSegTree* st);
+
+/**
+ * Compacts the arena into a new generation that only holds the current version and
+ * the given versions. Versions not listed become invalid.
+ *
+ * @param st        Handle from psegtree_build()
+ * @param live      Versions to keep. Rewritten in place to their new root indices
+ * @param n_live    Number of entries of live
+ */
+void psegtree_collect(PSegTree* st, PSegVersion* live, unsigned n_live);
+
+#endif // PSEGTREE_H
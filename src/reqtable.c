@@ -0,0 +1,160 @@
+//
+// reqtable.c
+// Column-wise view of a request queue, and lists of its row indices, for the schedulers
+//
+
+#include "reqtable.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long allocations = 0;
+
+/* PRIVATE METHODS */
+
+static void* grow_column(void* col, int capacity, size_t elem) {
+    void* grown = realloc(col, (size_t)capacity * elem);
+    if (grown == NULL) exit(1);
+    return grown;
+}
+
+// Stable merge of the sorted runs src[lo, mid) and src[mid, hi) into dst[lo, hi).
+static void merge_runs(const uint32_t* src, uint32_t* dst, int lo, int mid, int hi, const long long* key) {
+    int i = lo, j = mid;
+    for (int k = lo; k < hi; k++) {
+        if (j >= hi || (i < mid && key[src[i]] <= key[src[j]])) dst[k] = src[i++];
+        else dst[k] = src[j++];
+    }
+}
+
+// Bottom-up merge sort of a[0, n) using tmp[0, n).
+static void merge_sort(uint32_t* a, uint32_t* tmp, int n, const long long* key) {
+    uint32_t *src = a, *dst = tmp;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = (lo + width < n) ? lo + width : n;
+            int hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            merge_runs(src, dst, lo, mid, hi, key);
+        }
+        uint32_t* t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != a) memcpy(a, src, (size_t)n * sizeof(uint32_t));
+}
+
+/* PUBLIC METHODS */
+
+void request_table_build(RequestTable* table, const Vector* queue) {
+    *table = (RequestTable){0};
+    request_table_extend(table, queue);
+}
+
+void request_table_extend(RequestTable* table, const Vector* queue) {
+    int n = queue->size;
+    assert(n >= table->size);
+    if (n > table->capacity) {
+        int capacity = table->capacity * 2 > n ? table->capacity * 2 : n;
+        table->order = grow_column(table->order, capacity, sizeof(int));
+        table->start = grow_column(table->start, capacity, sizeof(int));
+        table->end = grow_column(table->end, capacity, sizeof(int));
+        table->resources = grow_column(table->resources, capacity, sizeof(ResourceMask));
+        table->volume = grow_column(table->volume, capacity, sizeof(int));
+        table->priority = grow_column(table->priority, capacity, sizeof(int));
+        table->work_hour = grow_column(table->work_hour, capacity, sizeof(uint8_t));
+        table->prio_key = grow_column(table->prio_key, capacity, sizeof(long long));
+        table->opti_key = grow_column(table->opti_key, capacity, sizeof(long long));
+        table->capacity = capacity;
+    }
+    table->rows = queue->data;
+
+    for (int i = table->size; i < n; i++) {
+        const Request* req = &queue->data[i];
+        int cnt = (int)resource_mask_count(req->resources);
+        table->order[i] = req->order;
+        table->start[i] = req->start;
+        table->end[i] = req->start + req->duration - 1;
+        table->resources[i] = req->resources;
+        table->volume[i] = req->duration * cnt;
+        table->priority[i] = req->priority;
+        table->work_hour[i] = (uint8_t)is_work_hour(table->start[i], table->end[i]);
+        // priority first, then requests within work hours first
+        table->prio_key[i] = (long long)req->priority * 2 + !table->work_hour[i];
+        // larger volume first, then more resources first (cnt <= MAX_RESOURCES < 64)
+        table->opti_key[i] = -((long long)table->volume[i] * 64 + cnt);
+    }
+    table->size = n;
+}
+
+void request_table_free(RequestTable* table) {
+    free(table->order);
+    free(table->start);
+    free(table->end);
+    free(table->resources);
+    free(table->volume);
+    free(table->priority);
+    free(table->work_hour);
+    free(table->prio_key);
+    free(table->opti_key);
+    *table = (RequestTable){0};
+}
+
+void request_table_collect(const RequestTable* table, const IndexList* list, Vector* vec) {
+    vector_reserve(vec, list->size);
+    for (int i = 0; i < list->size; i++) {
+        assert(list->data[i] < (uint32_t)table->size);
+        vec->data[i] = table->rows[list->data[i]];
+    }
+    vec->size = list->size;
+}
+
+void index_list_reserve(IndexList* list, int capacity) {
+    if (list->capacity >= capacity) return;
+    allocations++;
+    uint32_t* new_data = realloc(list->data, (size_t)capacity * sizeof(uint32_t));
+    if (!new_data) exit(1);
+    list->data = new_data;
+    list->capacity = capacity;
+}
+
+void index_list_add(IndexList* list, uint32_t index) {
+    if (list->size >= list->capacity) index_list_reserve(list, list->capacity ? list->capacity * 2 : 16);
+    list->data[list->size++] = index;
+}
+
+void index_list_overwrite(const IndexList* source, IndexList* target) {
+    index_list_reserve(target, source->size);
+    if (source->size > 0) memcpy(target->data, source->data, (size_t)source->size * sizeof(uint32_t));
+    target->size = source->size;
+}
+
+void index_list_free(IndexList* list) {
+    free(list->data);
+    list->data = NULL;
+    list->size = list->capacity = 0;
+}
+
+void index_list_sort(IndexList* list, const long long* key, IndexList* scratch) {
+    assert(scratch->capacity >= list->size);
+    uint32_t* a = list->data;
+    int n = list->size, sorted = 1;
+    while (sorted < n && key[a[sorted - 1]] <= key[a[sorted]]) sorted++;
+    if (sorted >= n) return;
+
+    // sort the tail in place, then merge from the back so that every index moves once
+    int k = n - sorted;
+    uint32_t* tail = scratch->data;
+    merge_sort(a + sorted, tail, k, key);
+    memcpy(tail, a + sorted, (size_t)k * sizeof(uint32_t));
+    int i = sorted - 1, j = k - 1;
+    for (int pos = n - 1; j >= 0; pos--) {
+        // on ties the tail index goes last, as it came later
+        if (i >= 0 && key[a[i]] > key[tail[j]]) a[pos] = a[i--];
+        else a[pos] = tail[j--];
+    }
+}
+
+unsigned long index_list_allocations(void) {
+    return allocations;
+}
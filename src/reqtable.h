@@ -0,0 +1,75 @@
+//
+// reqtable.h
+// Column-wise view of a request queue, and lists of its row indices, for the schedulers
+//
+
+#ifndef REQTABLE_H
+#define REQTABLE_H
+
+#include "vector.h"
+
+#include <stdint.h>
+
+// A list of row indices into a RequestTable. A zero-initialized IndexList is empty and valid.
+typedef struct IndexList {
+    uint32_t* data;
+    int size;
+    int capacity;
+} IndexList;
+
+// The requests of a queue, one column per field the schedulers read, built once per schedule.
+// Row i is queue->data[i]. The algorithms move 32-bit row indices around instead of Requests and
+// compare precomputed keys instead of calling the comparators of vector.h.
+typedef struct RequestTable {
+    int size;
+    int capacity;               // rows the columns have room for
+    const Request* rows;        // the queue the table was built from, see request_table_collect()
+    int* order;
+    int* start;
+    int* end;                   // inclusive
+    ResourceMask* resources;
+    int* volume;                // duration * number of resources
+    int* priority;
+    uint8_t* work_hour;         // is_work_hour() of [start, end]
+    long long* prio_key;        // ascending = cmp_priority() order
+    long long* opti_key;        // ascending = cmp_volume_cnt() order
+} RequestTable;
+
+/**
+ * Builds the table of queue, which must outlive it
+ */
+void request_table_build(RequestTable* table, const Vector* queue);
+
+/**
+ * Adds the rows of the requests appended to queue since the table was built or last extended.
+ * The rows already there keep their indices. queue may have been reallocated in between
+ */
+void request_table_extend(RequestTable* table, const Vector* queue);
+void request_table_free(RequestTable* table);
+
+/**
+ * Replaces the contents of vec with the requests of the rows in list, in list order
+ */
+void request_table_collect(const RequestTable* table, const IndexList* list, Vector* vec);
+
+void index_list_reserve(IndexList* list, int capacity);
+void index_list_add(IndexList* list, uint32_t index);
+void index_list_overwrite(const IndexList* source, IndexList* target);
+void index_list_free(IndexList* list);
+
+/**
+ * Sorts the list stably by key[index], ascending, without allocating. Its longest already sorted
+ * prefix is kept as is: only the remaining k indices are sorted, then merged in, so this costs
+ * O(n + k log k).
+ * @param list The list to be sorted
+ * @param key Sort key of every row
+ * @param scratch Buffer with room for at least list->size indices. Its contents are overwritten
+ */
+void index_list_sort(IndexList* list, const long long* key, IndexList* scratch);
+
+/**
+ * @return The number of times any index list has allocated or grown its buffer so far
+ */
+unsigned long index_list_allocations(void);
+
+#endif // REQTABLE_H
@@ -0,0 +1,274 @@
+//
+// resource.c
+// The resource registry: every bookable resource type and its capacity
+//
+
+#include "resource.h"
+#include "utils.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_LEN    512
+
+typedef struct Registry {
+    unsigned count;
+    unsigned parking;
+    Resource resources[MAX_RESOURCES];
+} Registry;
+
+// The fixed resources of the original SPMS, in the order their bits had in Request.essential.
+static Registry registry = {
+    .count = 4,
+    .parking = 0,
+    .resources = {
+        {"parking", 10, 1, {"Parking"}, 0, {""}},
+        {"battery_cable", 3, 2, {"Battery", "Cable"}, 3, {"battery", "cable", "cables"}},
+        {"locker_umbrella", 3, 2, {"Locker", "Umbrella"}, 2, {"locker", "umbrella"}},
+        {"inflation_valet", 3, 2, {"Inflation Service", "Valet Parking"}, 4,
+            {"InflationService", "inflation", "valetPark", "valet"}},
+    },
+};
+
+// Perfect hash of the item names of the registry, built on the first lookup after it changes.
+// Bucket hash_lowercase(item, 0) % ITEM_BUCKETS picks a displacement d, and slot
+// hash_lowercase(item, d + 1) % ITEM_SLOTS then holds no other item (hash and displace).
+#define ITEM_BUCKETS    64
+#define ITEM_SLOTS      512     // at least twice MAX_RESOURCES * MAX_ITEMS
+#define MAX_DISPLACEMENT 65536
+
+typedef struct ItemIndex {
+    bool ready;
+    bool perfect;                                   // false: no displacements found, search linearly
+    uint32_t displacement[ITEM_BUCKETS];
+    int16_t slot[ITEM_SLOTS];                       // r * MAX_ITEMS + i, or -1
+    char lower[MAX_RESOURCES * MAX_ITEMS][RESOURCE_NAME_LEN];  // item i of resource r, lowercased
+} ItemIndex;
+
+static ItemIndex item_index;
+
+/* PRIVATE METHODS */
+
+// Places the items of every bucket, largest buckets first, at the first displacement that puts
+// them all into free slots. Returns false if some bucket finds none.
+static bool place_items(const int* keys, int n) {
+    int bucket_of[MAX_RESOURCES * MAX_ITEMS], size[ITEM_BUCKETS] = {0};
+    for (int i = 0; i < n; i++) {
+        const char* name = item_index.lower[keys[i]];
+        bucket_of[i] = (int)(hash_lowercase(name, strlen(name), 0) % ITEM_BUCKETS);
+        size[bucket_of[i]]++;
+    }
+    for (int s = 0; s < ITEM_SLOTS; s++) item_index.slot[s] = -1;
+
+    for (int largest = MAX_RESOURCES * MAX_ITEMS; largest > 0; largest--) {
+        for (int b = 0; b < ITEM_BUCKETS; b++) {
+            if (size[b] != largest) continue;
+            bool placed = false;
+            for (uint32_t d = 0; d < MAX_DISPLACEMENT && !placed; d++) {
+                int slots[MAX_RESOURCES * MAX_ITEMS], used = 0;
+                placed = true;
+                for (int i = 0; i < n && placed; i++) {
+                    if (bucket_of[i] != b) continue;
+                    const char* name = item_index.lower[keys[i]];
+                    int s = (int)(hash_lowercase(name, strlen(name), d + 1) % ITEM_SLOTS);
+                    placed = item_index.slot[s] < 0;
+                    for (int j = 0; j < used && placed; j++) placed = slots[j] != s;
+                    slots[used++] = s;
+                }
+                if (!placed) continue;
+                item_index.displacement[b] = d;
+                used = 0;
+                for (int i = 0; i < n; i++) {
+                    if (bucket_of[i] == b) item_index.slot[slots[used++]] = (int16_t)keys[i];
+                }
+            }
+            if (!placed) return false;
+        }
+    }
+    return true;
+}
+
+static void build_item_index(void) {
+    int keys[MAX_RESOURCES * MAX_ITEMS], n = 0;
+    for (unsigned r = 0; r < registry.count; r++) {
+        for (unsigned i = 0; i < registry.resources[r].n_items; i++) {
+            int key = (int)(r * MAX_ITEMS + i);
+            const char* item = registry.resources[r].items[i];
+            size_t len = strlen(item);
+            for (size_t c = 0; c <= len; c++) item_index.lower[key][c] = (char)tolower((unsigned char)item[c]);
+            keys[n++] = key;
+        }
+    }
+    item_index.perfect = place_items(keys, n);
+    item_index.ready = true;
+}
+
+// Trims leading and trailing whitespace in place and returns the trimmed string.
+static char* trim(char* str) {
+    while (isspace((unsigned char)*str)) str++;
+    char* end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return str;
+}
+
+// Splits str at each separator into at most max trimmed, non-empty names.
+// Returns the number of names, or -1 if there are too many or one is too long.
+static int split_names(char* str, const char* separators, int max, char names[][RESOURCE_NAME_LEN]) {
+    int cnt = 0;
+    for (char* tok = strtok(str, separators); tok; tok = strtok(NULL, separators)) {
+        tok = trim(tok);
+        if (*tok == '\0') continue;
+        if (cnt == max || strlen(tok) >= RESOURCE_NAME_LEN) return -1;
+        strcpy(names[cnt++], tok);
+    }
+    return cnt;
+}
+
+// Parses "name | capacity | devices | items". Returns false if the line is malformed.
+static bool parse_resource(char* line, Resource* res) {
+    char* fields[4];
+    for (int i = 0; i < 4; i++) {
+        fields[i] = line;
+        line = strchr(line, '|');
+        if (line == NULL && i < 3) return false;
+        if (line) *line++ = '\0';
+    }
+    if (line != NULL) return false;  // more than 4 fields
+
+    char* name = trim(fields[0]);
+    if (*name == '\0' || strlen(name) >= RESOURCE_NAME_LEN) return false;
+    strcpy(res->name, name);
+
+    char* end;
+    long capacity = strtol(fields[1], &end, 10);
+    if (end == fields[1] || *trim(end) != '\0' || capacity < 1 || capacity > MAX_CAPACITY) return false;
+    res->capacity = (unsigned)capacity;
+
+    int n_devices = split_names(fields[2], ",", MAX_DEVICES, res->devices);
+    int n_items = split_names(fields[3], ", \t\r\n", MAX_ITEMS, res->items);
+    if (n_devices < 1 || n_items < 0) return false;
+    res->n_devices = (unsigned)n_devices;
+    res->n_items = (unsigned)n_items;
+    return true;
+}
+
+/* PUBLIC METHODS */
+
+bool resource_registry_load(const char* path) {
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: Cannot open the resource file %s\n", path);
+        return false;
+    }
+
+    Registry* reg = calloc(1, sizeof(Registry));
+    if (reg == NULL) exit(1);
+    bool has_parking = false, ok = true;
+    char line[LINE_LEN];
+    int line_no = 0;
+
+    while (ok && fgets(line, LINE_LEN, fp) != NULL) {
+        line_no++;
+        char* content = trim(line);
+        if (*content == '\0' || *content == '#') continue;
+
+        if (reg->count == MAX_RESOURCES) {
+            fprintf(stderr, "%s:%d: more than %d resources\n", path, line_no, MAX_RESOURCES);
+            ok = false;
+            break;
+        }
+        Resource* res = &reg->resources[reg->count];
+        if (!parse_resource(content, res)) {
+            fprintf(stderr, "%s:%d: expected \"name | capacity | Device, ... | item ...\"\n", path, line_no);
+            ok = false;
+            break;
+        }
+        for (unsigned r = 0; r < reg->count; r++) {
+            if (compare(reg->resources[r].name, res->name)) {
+                fprintf(stderr, "%s:%d: duplicate resource %s\n", path, line_no, res->name);
+                ok = false;
+            }
+            for (unsigned i = 0; i < reg->resources[r].n_items; i++) {
+                for (unsigned j = 0; j < res->n_items; j++) {
+                    if (compare(reg->resources[r].items[i], res->items[j])) {
+                        fprintf(stderr, "%s:%d: item %s already requests %s\n",
+                                path, line_no, res->items[j], reg->resources[r].name);
+                        ok = false;
+                    }
+                }
+            }
+        }
+        if (compare(res->name, "parking")) {
+            has_parking = true;
+            reg->parking = reg->count;
+        }
+        reg->count++;
+    }
+    fclose(fp);
+
+    if (ok && !has_parking) {
+        fprintf(stderr, "%s: no resource named parking\n", path);
+        ok = false;
+    }
+    if (ok) {
+        registry = *reg;
+        item_index.ready = false;
+    }
+    free(reg);
+    return ok;
+}
+
+uint32_t resource_registry_fingerprint(void) {
+    uint32_t hash = 0;
+    for (unsigned r = 0; r < registry.count; r++) {
+        const Resource* res = &registry.resources[r];
+        hash = hash_lowercase(res->name, strlen(res->name), hash);
+        for (unsigned i = 0; i < res->n_items; i++) hash = hash_lowercase(res->items[i], strlen(res->items[i]), hash);
+        hash = hash_lowercase("|", 1, hash);
+    }
+    return hash;
+}
+
+unsigned resource_count(void) {
+    return registry.count;
+}
+
+const Resource* resource_get(unsigned r) {
+    return &registry.resources[r];
+}
+
+int resource_lookup(const char* item) {
+    return resource_lookup_n(item, strlen(item));
+}
+
+int resource_lookup_n(const char* item, size_t len) {
+    if (!item_index.ready) build_item_index();
+    if (len == 0 || len >= RESOURCE_NAME_LEN) return -1;
+
+    if (!item_index.perfect) {
+        for (unsigned r = 0; r < registry.count; r++) {
+            for (unsigned i = 0; i < registry.resources[r].n_items; i++) {
+                if (equals_lowercase(item, len, item_index.lower[r * MAX_ITEMS + i])) return (int)r;
+            }
+        }
+        return -1;
+    }
+
+    uint32_t d = item_index.displacement[hash_lowercase(item, len, 0) % ITEM_BUCKETS];
+    int key = item_index.slot[hash_lowercase(item, len, d + 1) % ITEM_SLOTS];
+    if (key < 0 || !equals_lowercase(item, len, item_index.lower[key])) return -1;
+    return key / MAX_ITEMS;
+}
+
+unsigned resource_parking(void) {
+    return registry.parking;
+}
+
+unsigned resource_total_capacity(void) {
+    unsigned total = 0;
+    for (unsigned r = 0; r < registry.count; r++) total += registry.resources[r].capacity;
+    return total;
+}
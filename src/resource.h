@@ -0,0 +1,87 @@
+//
+// resource.h
+// The resource registry: every bookable resource type and its capacity
+//
+
+#ifndef RESOURCE_H
+#define RESOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_RESOURCES       32      // bits of a ResourceMask
+#define MAX_CAPACITY        4096
+#define MAX_DEVICES         4
+#define MAX_ITEMS           8
+#define RESOURCE_NAME_LEN   32
+
+// Bit r is set iff a request needs one instance of resource r.
+typedef uint32_t ResourceMask;
+
+#define RESOURCE_BIT(r)     ((ResourceMask)1 << (r))
+
+/**
+ * A resource type with `capacity` interchangeable instances.
+ *
+ * @param name          Identifier in the registry file
+ * @param capacity      Number of instances (slots)
+ * @param n_devices     Number of device labels
+ * @param devices       Labels printed for a booking of this resource, and in the utilization report
+ * @param n_items       Number of item names
+ * @param items         Names a command may use to request this resource (case-insensitive)
+ */
+typedef struct Resource {
+    char name[RESOURCE_NAME_LEN];
+    unsigned capacity;
+    unsigned n_devices;
+    char devices[MAX_DEVICES][RESOURCE_NAME_LEN];
+    unsigned n_items;
+    char items[MAX_ITEMS][RESOURCE_NAME_LEN];
+} Resource;
+
+/**
+ * Replaces the registry with the resources listed in a file, one per line:
+ *
+ *     name | capacity | Device Label, ... | item ...
+ *
+ * Blank lines and lines starting with '#' are ignored. A resource named "parking" must be present;
+ * it is requested by addParking, addReservation and addEvent instead of by item names.
+ * Must be called before any Tracker is built.
+ *
+ * @param path      Path of the registry file
+ * @return          false, printing the reason and leaving the registry unchanged, on any error
+ */
+bool resource_registry_load(const char* path);
+
+// Hash of the names and items of the registry, in order: what decides the bits of the masks that
+// parsing a command gives.
+uint32_t resource_registry_fingerprint(void);
+
+// Number of registered resources. The default registry has parking (10) and three pairs of
+// essentials (3 each), matching the original SPMS.
+unsigned resource_count(void);
+const Resource* resource_get(unsigned r);
+
+// Index of the resource requested by `item`, -1 if no resource lists it. Case-insensitive, O(len).
+int resource_lookup(const char* item);
+
+// Same as resource_lookup(), for the first len characters of item.
+int resource_lookup_n(const char* item, size_t len);
+
+// Index of the "parking" resource.
+unsigned resource_parking(void);
+
+// Sum of all capacities.
+unsigned resource_total_capacity(void);
+
+static inline unsigned resource_mask_count(ResourceMask mask) {
+    return (unsigned)__builtin_popcount(mask);
+}
+
+// Lowest resource of a non-empty mask. Iterate with `for (m = mask; m; m &= m - 1)`.
+static inline unsigned resource_mask_first(ResourceMask mask) {
+    return (unsigned)__builtin_ctz(mask);
+}
+
+#endif //RESOURCE_H
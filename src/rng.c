@@ -1,32 +1,112 @@
 #include "rng.h"
 
-static unsigned long long s[2];
+#define BULK_CHUNK  256     // raw draws buffered by the bulk fills
+
+static Rng global;
 static const unsigned long long s1_base = 0xf2e6bcd65ef0803c;
 static const unsigned long long s2_base = 0xc51b10664c184979;
 
-void seed(unsigned long long s1, unsigned long long s2) {
-    s[0] = s1 ? s1 ^ s1_base : s1_base;
-    s[1] = s2 ? s2 ^ s2_base : s2_base;
+void rng_seed(Rng* rng, unsigned long long s1, unsigned long long s2) {
+    rng->s[0] = s1 ? s1 ^ s1_base : s1_base;
+    rng->s[1] = s2 ? s2 ^ s2_base : s2_base;
 }
 
-static unsigned long long next() {
-    unsigned long long a = s[0], b = s[1];
-    s[0] = b;
+unsigned long long rng_next(Rng* rng) {
+    unsigned long long a = rng->s[0], b = rng->s[1];
+    rng->s[0] = b;
     a ^= a << 23;
     a ^= a >> 17;
     a ^= b ^ (b >> 26);
-    s[1] = a;
-    return s[0] + a;
+    rng->s[1] = a;
+    return rng->s[0] + a;
 }
 
-double randd() {
-    return ((double)(next() >> 11)) * 0x1.0p-53; 
+double rng_double(Rng* rng) {
+    return ((double)(rng_next(rng) >> 11)) * 0x1.0p-53;
     // extract top 53 bits, then multiply by 2^-53 -> [0, 1)
     // 0x1.0p-53 = hex representation of 2^-53
 }
 
-int randi(int l, int r) {
-    unsigned long long next_val = next();
+int rng_int(Rng* rng, int l, int r) {
+    unsigned long long next_val = rng_next(rng);
     int next_int = (int)(next_val >> 32 ^ next_val);
     return next_int % (r - l) + l;
 }
+
+void rng_jump(Rng* rng) {
+    // x^(2^64) mod the characteristic polynomial of rng_next(), lowest coefficient first
+    static const unsigned long long jump[2] = {0x8c405782bca686adULL, 0xc44f35946fef49c6ULL};
+    unsigned long long s0 = 0, s1 = 0;
+    for (int i = 0; i < 2; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ULL << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+            }
+            rng_next(rng);
+        }
+    }
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+}
+
+// The recurrence itself is serial, so the bulk fills draw raw values in a tight loop with the
+// state in registers, then convert a whole chunk in a loop without dependencies.
+static void fill_raw(Rng* rng, unsigned long long* out, int n) {
+    unsigned long long s0 = rng->s[0], s1 = rng->s[1];
+    for (int i = 0; i < n; i++) {
+        unsigned long long a = s0, b = s1;
+        s0 = b;
+        a ^= a << 23;
+        a ^= a >> 17;
+        a ^= b ^ (b >> 26);
+        s1 = a;
+        out[i] = s0 + a;
+    }
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+}
+
+void rng_fill_doubles(Rng* rng, double* out, int n) {
+    unsigned long long raw[BULK_CHUNK];
+    for (int done = 0; done < n; done += BULK_CHUNK) {
+        int cnt = (n - done < BULK_CHUNK) ? n - done : BULK_CHUNK;
+        fill_raw(rng, raw, cnt);
+        for (int i = 0; i < cnt; i++) out[done + i] = (double)(raw[i] >> 11) * 0x1.0p-53;
+    }
+}
+
+void rng_fill_bernoulli(Rng* rng, unsigned char* out, int n, double p) {
+    // (x >> 11) * 2^-53 < p  <=>  (x >> 11) < p * 2^53, and p * 2^53 is exact
+    double scaled = p * 0x1.0p53;
+    unsigned long long threshold;
+    if (scaled <= 0) threshold = 0;
+    else if (scaled >= 0x1.0p53) threshold = 1ULL << 53;
+    else {
+        threshold = (unsigned long long)scaled;
+        if ((double)threshold < scaled) threshold++;  // ceil
+    }
+
+    unsigned long long raw[BULK_CHUNK];
+    for (int done = 0; done < n; done += BULK_CHUNK) {
+        int cnt = (n - done < BULK_CHUNK) ? n - done : BULK_CHUNK;
+        fill_raw(rng, raw, cnt);
+        for (int i = 0; i < cnt; i++) out[done + i] = (unsigned char)((raw[i] >> 11) < threshold);
+    }
+}
+
+Rng* rng_global() {
+    return &global;
+}
+
+void seed(unsigned long long s1, unsigned long long s2) {
+    rng_seed(&global, s1, s2);
+}
+
+double randd() {
+    return rng_double(&global);
+}
+
+int randi(int l, int r) {
+    return rng_int(&global, l, r);
+}
@@ -1,6 +1,33 @@
 #ifndef RNG_H
 #define RNG_H
 
+// An independent xorshift128+ generator. Seed with rng_seed() before use.
+typedef struct Rng {
+    unsigned long long s[2];
+} Rng;
+
+void rng_seed(Rng* rng, unsigned long long s1, unsigned long long s2);
+unsigned long long rng_next(Rng* rng);
+
+// Uniform in [0, 1)
+double rng_double(Rng* rng);
+
+// Uniform in [l, r)
+int rng_int(Rng* rng, int l, int r);
+
+// Advances the generator by 2^64 steps. Calling it i times after the same rng_seed() gives
+// the i-th of 2^64 non-overlapping streams.
+void rng_jump(Rng* rng);
+
+// Fills out[0 .. n) with the next n values of rng_double(), in the same order.
+void rng_fill_doubles(Rng* rng, double* out, int n);
+
+// out[i] = (rng_double() < p) for the next n draws, in the same order.
+void rng_fill_bernoulli(Rng* rng, unsigned char* out, int n, double p);
+
+// The generator behind seed(), randd() and randi().
+Rng* rng_global();
+
 void seed(unsigned long long s1, unsigned long long s2);
 double randd();
 int randi(int l, int r);
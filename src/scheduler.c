@@ -9,62 +9,126 @@
 #include <sys/wait.h>
 
 #include "scheduler.h"
+#include "batch.h"
 #include "input.h"
 #include "vector.h"
 #include "state.h"
 #include "opti.h"
+#include "rng.h"
+
+static bool process_nested_batch(Vector* queue, const Command* cmd, int* invalid_cnt, bool run_prints);
 
 void process_request(Vector* queue, Request* req) {
     req->order = queue->size + 1; // order start from 1
     vector_add(queue, *req);
 }
 
-bool process_batch(Vector* queue, Request* req, int* invalid_cnt) {
+// Runs an addBatch, printBookings or endProgram line of a batch file. Returns true if it ends the program.
+static bool run_barrier(Vector* queue, const Command* cmd, int* invalid_cnt, bool run_prints) {
+    switch (cmd->type) {
+        case BATCH:
+            return process_nested_batch(queue, cmd, invalid_cnt, run_prints);
+        case TERMINATE:
+            return true;
+        case PRINT:
+            if (!run_prints) return false;
+            printf("PRINTING\n");
+            schedule_and_print_bookings(cmd->algo, cmd->format, cmd->file, queue, *invalid_cnt);
+            return false;
+        default:
+            return false;
+    }
+}
+
+// Adds the requests and invalid lines of a chunk between two of its barriers to the queue, numbering
+// the requests after those already in it, and prints the parser messages about them.
+static void stitch_range(Vector* queue, const ParsedChunk* chunk, int* invalid_cnt,
+                         int requests_from, int requests_to, int invalid_from, int invalid_to,
+                         size_t messages_from, size_t messages_to) {
+    fwrite(chunk->messages.data + messages_from, 1, messages_to - messages_from, stdout);
+    int first = queue->size;
+    vector_append(queue, chunk->requests.data + requests_from, requests_to - requests_from);
+    for (int i = first; i < queue->size; i++) queue->data[i].order = i + 1; // order start from 1
+    *invalid_cnt += invalid_to - invalid_from;
+}
+
+// Adds what the chunks of a batch file parsed to the queue, in file order, running every barrier
+// once the lines before it are in. Returns true if one of them ends the program.
+static bool stitch_chunks(Vector* queue, const ParsedChunk* chunks, int count, int* invalid_cnt, bool run_prints) {
+    for (int c = 0; c < count; c++) {
+        const ParsedChunk* chunk = &chunks[c];
+        int requests = 0, invalid = 0;
+        size_t messages = 0;
+        for (int b = 0; b < chunk->barriers_cnt; b++) {
+            const ChunkBarrier* barrier = &chunk->barriers[b];
+            stitch_range(queue, chunk, invalid_cnt, requests, barrier->requests, invalid, barrier->invalid_cnt,
+                         messages, barrier->messages);
+            requests = barrier->requests;
+            invalid = barrier->invalid_cnt;
+            messages = barrier->messages;
+            if (run_barrier(queue, &barrier->cmd, invalid_cnt, run_prints)) return true;
+        }
+        stitch_range(queue, chunk, invalid_cnt, requests, chunk->requests.size, invalid, chunk->invalid_cnt,
+                     messages, chunk->messages.size);
+    }
+    return false;
+}
+
+// Adds the requests of a batch file, text or compiled, to the queue. Nested printBookings are run
+// only if run_prints. Returns false if the file cannot be read; ends_program tells whether it ended
+// at an endProgram.
+static bool load_batch(Vector* queue, const char* file, int* invalid_cnt, bool run_prints, bool* ends_program) {
     // read the batch file
     // parse the batch file
     // add the requests to the queue
 
     // int line_cnt = 0 , line_n = 0, lines[1000];
-    const char* file = req->file;
-    FILE* fp = fopen(file, "r");
+    BatchReader reader;
+    *ends_program = false;
 
-    if (fp == NULL) {
+    if (!batch_open(&reader, file)) {
         printf("Error: Cannot open the batch file %s\n", file);
         return false;
     }
+
+    if (batch_is_compiled(&reader)) {
+        bool ok = batch_load_compiled(&reader, file, queue, invalid_cnt, ends_program);
+        batch_close(&reader);
+        return ok;
+    }
+
+    ParsedChunk* chunks;
+    int chunks_cnt = batch_parse_parallel(&reader, &chunks);
+    if (chunks_cnt > 0) {
+        *ends_program = stitch_chunks(queue, chunks, chunks_cnt, invalid_cnt, run_prints);
+        batch_free_chunks(chunks, chunks_cnt);
+        batch_close(&reader);
+        return true;
+    }
     
-    while (!feof(fp)) {
-        Request rq = file_input(fp);
+    StringView line;
+    while (batch_next_line(&reader, &line)) {
+        // a NULL line is the end of the file, which the feof() loop this replaces read as one more invalid line
+        Command rq = line.data ? parse_line(line.data, line.len) : (Command){.type = INVALID};
         // line_cnt++;
         switch (rq.type) {
-            case BATCH: {
-                bool is_end = process_batch(queue, &rq, invalid_cnt);
-                if (!is_end) break;
-                __attribute__((fallthrough));
-            }
-            case TERMINATE:
-                fclose(fp);
-                return true;
             case REQUEST:
-                process_request(queue, &rq);
-                break;
-            case PRINT:
-                printf("PRINTING\n");
-                if (fork() == 0) {
-                    schedule_and_print_bookings(req->algo, queue, *invalid_cnt);
-                    exit(0);
-                } else {
-                    wait(NULL);
-                }
+                process_request(queue, &rq.request);
                 break;
             case INVALID:
                 (*invalid_cnt)++;
                 // lines[line_n++] = line_cnt;
                 break;
             default:
+                if (run_barrier(queue, &rq, invalid_cnt, run_prints)) {
+                    batch_close(&reader);
+                    *ends_program = true;
+                    return true;
+                }
                 break;
         }
     }
+    batch_close(&reader);
 
     /* DEBUG CODE
     printf("DEBUG: INVALID REQUESTS LINE NUMBER: ");
@@ -73,65 +137,197 @@ bool process_batch(Vector* queue, Request* req, int* invalid_cnt) {
     }
     */
 
-    return false;
+    return true;
+}
+
+// Loads the batch of an addBatch command, and compiles what it added into cmd->compiled if given.
+static bool process_nested_batch(Vector* queue, const Command* cmd, int* invalid_cnt, bool run_prints) {
+    int first = queue->size, invalid_before = *invalid_cnt;
+    bool ends_program;
+    if (!load_batch(queue, cmd->file, invalid_cnt, run_prints, &ends_program)) return false;
+
+    if (cmd->compiled[0] != '\0') {
+        batch_write_compiled(cmd->compiled, queue->data + first, queue->size - first,
+                             *invalid_cnt - invalid_before, ends_program);
+    }
+    return ends_program;
 }
 
-void run_fcfs(Vector* queue, Statistics* stats, Tracker* tracker) {
-    for (int i = 0; i < queue->size; i++) {
-        Request req = queue->data[i];
-        int end = req.start + req.duration - 1;
-        if (try_put(req.order, req.start, end, req.parking, req.essential, tracker)) { 
-            vector_add(&stats->accepted, req);
+bool process_batch(Vector* queue, Command* cmd, int* invalid_cnt) {
+    return process_nested_batch(queue, cmd, invalid_cnt, true);
+}
+
+bool compile_batch(const char* file, const char* compiled) {
+    Vector queue;
+    vector_init(&queue);
+    int invalid_cnt = 0;
+    bool ends_program;
+    bool ok = load_batch(&queue, file, &invalid_cnt, false, &ends_program) &&
+              batch_write_compiled(compiled, queue.data, queue.size, invalid_cnt, ends_program);
+    if (ok) {
+        printf("Compiled %d requests and %d invalid lines of %s into %s\n", queue.size, invalid_cnt, file, compiled);
+    }
+    vector_free(&queue);
+    return ok;
+}
+
+// FCFS decides on each request alone, in order of arrival, so appending requests never changes the
+// decisions about the earlier ones: only the rows from `from` on are admitted, and added to stats.
+void run_fcfs(const RequestTable* table, int from, Statistics* stats, Tracker* tracker) {
+    for (int i = from; i < table->size; i++) {
+        bool fits = try_put(table->order[i], table->start[i], table->end[i], table->resources[i], tracker);
+        vector_add(fits ? &stats->accepted : &stats->rejected, table->rows[i]);
+    }
+}
+
+static int prio_interval(const PrioState* prio) {
+    return prio->interval ? prio->interval : PRIO_CHECKPOINT_INTERVAL;
+}
+
+// Position of the next checkpoint to take.
+static int prio_next_checkpoint(const PrioState* prio) {
+    int last = prio->checkpoints_cnt ? prio->checkpoints[prio->checkpoints_cnt - 1].pos : 0;
+    return last + prio_interval(prio);
+}
+
+// Drops every other checkpoint and doubles the interval. Only used for full tracker copies.
+static void prio_thin_checkpoints(PrioState* prio) {
+    int interval = prio_interval(prio) * 2, kept = 0;
+    for (int i = 0; i < prio->checkpoints_cnt; i++) {
+        if (prio->checkpoints[i].pos % interval == 0) {
+            prio->checkpoints[kept++] = prio->checkpoints[i];
         } else {
-            vector_add(&stats->rejected, req);
+            tracker_free_snapshot(&prio->checkpoints[i].tracker);
         }
     }
+    prio->checkpoints_cnt = kept;
+    prio->interval = interval;
 }
 
-void run_prio(Vector* queue, Statistics* stats, Tracker* tracker) {
-    vector_qsort(queue, 0, queue->size-1, cmp_priority);
-    for (int i = 0; i < queue->size; i++) {
-        Request req = queue->data[i];
-        int end = req.start + req.duration - 1;
-        if (try_put(req.order, req.start, end, req.parking, req.essential, tracker)) { 
-            vector_add(&stats->accepted, req);
-        } else {
-            vector_add(&stats->rejected, req);
+static void prio_push_checkpoint(PrioState* prio, int pos, const Statistics* stats, Tracker* tracker) {
+    if (prio->checkpoints_cnt == prio->checkpoints_capacity) {
+        int capacity = prio->checkpoints_capacity ? prio->checkpoints_capacity * 2 : 16;
+        PrioCheckpoint* grown = realloc(prio->checkpoints, (size_t)capacity * sizeof(PrioCheckpoint));
+        if (grown == NULL) exit(1);
+        prio->checkpoints = grown;
+        prio->checkpoints_capacity = capacity;
+    }
+    PrioCheckpoint* checkpoint = &prio->checkpoints[prio->checkpoints_cnt++];
+    checkpoint->pos = pos;
+    checkpoint->tracker = (TrackerSnapshot){0};
+    tracker_snapshot(tracker, &checkpoint->tracker);
+    checkpoint->accepted_cnt = stats->accepted.size;
+    checkpoint->rejected_cnt = stats->rejected.size;
+
+    if (!tracker_can_snapshot(tracker) && prio->checkpoints_cnt > PRIO_MAX_COPY_CHECKPOINTS) {
+        prio_thin_checkpoints(prio);
+    }
+}
+
+// Goes back to the state of the last checkpoint at or before position `pos` of the priority order
+// (or to the empty state), drops the checkpoints after it, and returns its position.
+static int prio_rewind(PrioState* prio, int pos, Statistics* stats, Tracker* tracker) {
+    int keep = prio->checkpoints_cnt;
+    while (keep > 0 && prio->checkpoints[keep - 1].pos > pos) keep--;
+    while (prio->checkpoints_cnt > keep) tracker_free_snapshot(&prio->checkpoints[--prio->checkpoints_cnt].tracker);
+
+    if (keep == 0) {
+        reset_tracker(tracker);
+        stats->accepted.size = 0;
+        stats->rejected.size = 0;
+        return 0;
+    }
+    const PrioCheckpoint* checkpoint = &prio->checkpoints[keep - 1];
+    tracker_restore(tracker, &checkpoint->tracker);
+    stats->accepted.size = checkpoint->accepted_cnt;
+    stats->rejected.size = checkpoint->rejected_cnt;
+
+    // the states after the checkpoint are unreachable now
+    TrackerSnapshot* live[keep];
+    for (int i = 0; i < keep; i++) live[i] = &prio->checkpoints[i].tracker;
+    tracker_collect(tracker, live, (unsigned)keep);
+    return checkpoint->pos;
+}
+
+// PRIO admits the requests in the order of prio_key, ties in order of arrival. Rows appended to the
+// table sort after every earlier row of the same key, so the order (and every decision) before the
+// first of them stays the same: only the requests from the last checkpoint before it on are
+// admitted again.
+void run_prio(const RequestTable* table, PrioState* prio, Statistics* stats, Tracker* tracker) {
+    IndexList* order = &prio->order;
+    int old = order->size;
+    if (old == table->size) return;
+
+    index_list_reserve(order, table->size);
+    index_list_reserve(&prio->scratch, table->size);
+    for (int i = old; i < table->size; i++) index_list_add(order, (uint32_t)i);
+    index_list_sort(order, table->prio_key, &prio->scratch);
+
+    int first = old;
+    for (int i = 0; i < old; i++) {
+        if (order->data[i] >= (uint32_t)old) {
+            first = i;
+            break;
         }
     }
+    int from = prio_rewind(prio, first, stats, tracker);
+
+    for (int i = from; i < order->size; i++) {
+        if (i == prio_next_checkpoint(prio)) prio_push_checkpoint(prio, i, stats, tracker);
+        uint32_t req = order->data[i];
+        bool fits = try_put(table->order[req], table->start[req], table->end[req], table->resources[req], tracker);
+        vector_add(fits ? &stats->accepted : &stats->rejected, table->rows[req]);
+    }
+}
+
+void prio_state_free(PrioState* prio) {
+    while (prio->checkpoints_cnt > 0) tracker_free_snapshot(&prio->checkpoints[--prio->checkpoints_cnt].tracker);
+    free(prio->checkpoints);
+    index_list_free(&prio->order);
+    index_list_free(&prio->scratch);
+    *prio = (PrioState){0};
 }
 
 // Simulated Annealing (SA) + Improved LJF Greedy Algorithm.
-void run_opti(Vector* queue, Statistics* stats, Tracker* tracker) {
-    Vector* rejected = malloc(sizeof(Vector));
-    Vector* accepted = malloc(sizeof(Vector));
-    vector_init(accepted);
-    vector_init(rejected);
-    vector_overwrite(queue, rejected);
-
-    opti_reset();
+// Leaves the final schedule in the accepted and rejected lists of the returned workspace.
+// warm: see opti_reset().
+static OptiWorkspace* run_opti_chain(const RequestTable* table, Tracker* tracker, const IndexList* warm) {
+    OptiWorkspace* ws = opti_reset(tracker, table, warm);
+    IndexList* rejected = &ws->rejected;
+    IndexList* accepted = &ws->accepted;
+    const unsigned long allocations = opti_allocations();
     double cur_util = 0.0;
 
+    if (warm) {
+        // start from the earlier schedule, with the requests added since put in greedily
+        index_list_sort(rejected, table->opti_key, &ws->scratch);
+        opti_greedy(rejected, accepted, tracker, false);
+        cur_util = opti_util(tracker);
+        opti_store_best(accepted, rejected, tracker, cur_util);
+        opti_backup(tracker);
+    }
+
     /* Start SA */
 
     while (opti_running()) {
         // printf("DEBUG: Iteration %d\n", it++);
-        vector_qsort(rejected, 0, rejected->size - 1, cmp_volume_cnt);
+        // only the requests opti_delete() moved in the last step are out of order
+        index_list_sort(rejected, table->opti_key, &ws->scratch);
         opti_delete(rejected, accepted, tracker);
         // printf("DEBUG: delete\n");
         opti_greedy(rejected, accepted, tracker, true);
         // printf("DEBUG: greedy\n");
-        double tmp_util = opti_util(accepted);
-        opti_store_best(accepted, rejected, tmp_util);
+        double tmp_util = opti_util(tracker);
+        opti_store_best(accepted, rejected, tracker, tmp_util);
         // printf("DEBUG: NEW UTIL = %.3lf\n", tmp_util);
         if (opti_accept(tmp_util, cur_util)) {
             cur_util = tmp_util;
-            opti_backup(rejected, accepted, tracker);
+            opti_backup(tracker);
             // printf("ACCEPTED\n");
             // debug_util(accepted);
         }
         else {
-            opti_rollback(rejected, accepted, tracker);
+            opti_rollback(tracker);
             // printf("REJECTED, rolling back\n");
             // debug_util(accepted);
         }
@@ -139,16 +335,180 @@ void run_opti(Vector* queue, Statistics* stats, Tracker* tracker) {
     }
     opti_get_best_accepted(accepted);
     opti_get_best_rejected(rejected);
+    opti_get_best_tracker(tracker);
     
-    vector_qsort(rejected, 0, rejected->size - 1, cmp_volume_cnt);
+    index_list_sort(rejected, table->opti_key, &ws->scratch);
     opti_greedy(rejected, accepted, tracker, false);
+    assert(opti_allocations() == allocations);  // everything above ran inside the workspace
+    (void)allocations;
+    return ws;
+}
 
-    /* Free Memory */
-    vector_overwrite(accepted, &stats->accepted);
-    vector_overwrite(rejected, &stats->rejected);
-    vector_free(accepted);
-    vector_free(rejected);
-    free(accepted);
-    free(rejected);
+// What an OPTI worker sends after OPTI_RESULT, followed by the table rows of its accepted and then
+// its rejected requests, each in the order of its lists.
+typedef struct OptiResult {
+    double util;
+    int accepted_cnt;
+    int rejected_cnt;
+} OptiResult;
+
+static void send_opti_result(int fd, const OptiWorkspace* ws, const Tracker* tracker) {
+    const IndexList* lists[2] = {&ws->accepted, &ws->rejected};
+    OptiResult result = {opti_util(tracker), ws->accepted.size, ws->rejected.size};
+    bool ok = pipe_write(fd, &(PipeMessageType){OPTI_RESULT}, sizeof(PipeMessageType)) &&
+              pipe_write(fd, &result, sizeof(OptiResult));
+    for (int l = 0; l < 2 && ok; l++) {
+        ok = pipe_write(fd, lists[l]->data, (size_t)lists[l]->size * sizeof(uint32_t));
+    }
+}
 
-}
\ No newline at end of file
+// Reads one worker's result into the lists of rows.
+static bool receive_opti_result(int fd, const RequestTable* table, IndexList* accepted, IndexList* rejected,
+                                double* util) {
+    PipeMessageType type;
+    OptiResult result;
+    if (!pipe_read(fd, &type, sizeof(PipeMessageType)) || type != OPTI_RESULT ||
+        !pipe_read(fd, &result, sizeof(OptiResult)) ||
+        result.accepted_cnt < 0 || result.rejected_cnt < 0 ||
+        result.accepted_cnt + result.rejected_cnt != table->size) {
+        return false;
+    }
+
+    IndexList* lists[2] = {accepted, rejected};
+    int counts[2] = {result.accepted_cnt, result.rejected_cnt};
+    for (int l = 0; l < 2; l++) {
+        index_list_reserve(lists[l], counts[l]);
+        if (!pipe_read(fd, lists[l]->data, (size_t)counts[l] * sizeof(uint32_t))) return false;
+        lists[l]->size = counts[l];
+        for (int i = 0; i < counts[l]; i++) {
+            if (lists[l]->data[i] >= (uint32_t)table->size) return false;
+        }
+    }
+    *util = result.util;
+    return true;
+}
+
+// Runs one annealing chain per worker, each in its own process and with its own random stream,
+// and keeps the schedule with the highest utilization. Worker 0 draws the same numbers as a
+// single chain would, so the result is never worse than with one worker.
+static bool run_opti_workers(const RequestTable* table, OptiState* opti, Statistics* stats, Tracker* tracker,
+                             const IndexList* warm, unsigned workers) {
+    int fds[workers];
+    unsigned started = 0;
+    fflush(stdout);  // or the workers would flush our pending output again on exit
+
+    for (; started < workers; started++) {
+        int fd[2];
+        if (pipe(fd) < 0) break;
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            close(fd[0]);
+            close(fd[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(fd[0]);
+            for (unsigned w = 0; w < started; w++) close(fds[w]);
+            for (unsigned w = 0; w < started; w++) rng_jump(rng_global());
+            send_opti_result(fd[1], run_opti_chain(table, tracker, warm), tracker);
+            close(fd[1]);
+            exit(0);
+        }
+        close(fd[1]);
+        fds[started] = fd[0];
+    }
+
+    IndexList accepted = {0}, rejected = {0}, best_rejected = {0};
+    double best_util = -1.0, util;
+    for (unsigned w = 0; w < started; w++) {
+        if (receive_opti_result(fds[w], table, &accepted, &rejected, &util) && util > best_util) {
+            best_util = util;
+            index_list_overwrite(&accepted, &opti->accepted);
+            index_list_overwrite(&rejected, &best_rejected);
+        }
+        close(fds[w]);
+    }
+    for (unsigned w = 0; w < started; w++) wait(NULL);
+
+    if (best_util >= 0) {
+        request_table_collect(table, &opti->accepted, &stats->accepted);
+        request_table_collect(table, &best_rejected, &stats->rejected);
+        reset_tracker(tracker);
+        fill_tracker(tracker, &stats->accepted);
+    }
+    index_list_free(&accepted);
+    index_list_free(&rejected);
+    index_list_free(&best_rejected);
+    return best_util >= 0;
+}
+
+// Every run after the first is warm-started from the schedule of the one before, which the tracker
+// still holds, and only has to fit the requests added since.
+void run_opti(const RequestTable* table, OptiState* opti, Statistics* stats, Tracker* tracker) {
+    if (opti->generation == table->size) return;
+    const IndexList* warm = opti->generation > 0 ? &opti->accepted : NULL;
+    opti->generation = table->size;
+
+    if (opti_workers() > 1 && run_opti_workers(table, opti, stats, tracker, warm, opti_workers())) return;
+    OptiWorkspace* ws = run_opti_chain(table, tracker, warm);
+    request_table_collect(table, &ws->accepted, &stats->accepted);
+    request_table_collect(table, &ws->rejected, &stats->rejected);
+    index_list_overwrite(&ws->accepted, &opti->accepted);
+}
+
+void opti_state_free(OptiState* opti) {
+    index_list_free(&opti->accepted);
+    *opti = (OptiState){0};
+}
+
+const char* algorithm_name(Algorithm algo) {
+    static const char* names[ALGO_COUNT] = {"FCFS", "PRIO", "OPTI"};
+    return names[algo];
+}
+
+void schedule_init(Schedule* schedule, Algorithm algo) {
+    schedule->algo = algo;
+    vector_init(&schedule->queue);
+    schedule->scheduled = 0;
+    schedule->table = (RequestTable){0};
+    schedule->prio = (PrioState){0};
+    schedule->opti = (OptiState){0};
+    // OPTI snapshots its best state, which is O(1) with the persistent backend.
+    init_tracker_backend(&schedule->tracker, tracker_preferred_backend(algo == ALGO_OPTI));
+    init_statistics(&schedule->stats);
+    schedule->rng = *rng_global();
+}
+
+void schedule_free(Schedule* schedule) {
+    vector_free(&schedule->queue);
+    request_table_free(&schedule->table);
+    prio_state_free(&schedule->prio);
+    opti_state_free(&schedule->opti);
+    free_tracker(&schedule->tracker);
+    vector_free(&schedule->stats.accepted);
+    vector_free(&schedule->stats.rejected);
+}
+
+void schedule_update(Schedule* schedule) {
+    if (schedule->scheduled == schedule->queue.size) return;
+
+    request_table_extend(&schedule->table, &schedule->queue);
+
+    switch (schedule->algo) {
+        case ALGO_FCFS:
+            run_fcfs(&schedule->table, schedule->scheduled, &schedule->stats, &schedule->tracker);
+            break;
+        case ALGO_PRIO:
+            run_prio(&schedule->table, &schedule->prio, &schedule->stats, &schedule->tracker);
+            break;
+        case ALGO_OPTI:
+            // every run draws the same numbers, like a first run in a fresh process would
+            *rng_global() = schedule->rng;
+            run_opti(&schedule->table, &schedule->opti, &schedule->stats, &schedule->tracker);
+            break;
+        default:
+            break;
+    }
+    schedule->scheduled = schedule->queue.size;
+}
@@ -10,16 +10,104 @@
 #include "segtree.h"
 #include "utils.h"
 #include "state.h"
+#include "reqtable.h"
+#include "rng.h"
 
 #include <stdbool.h>
 
 void process_request(Vector* queue, Request* req);
-bool process_batch(Vector* queue, Request* req, int* invalid_cnt);
+bool process_batch(Vector* queue, Command* cmd, int* invalid_cnt);
+
+/**
+ * @brief Compiles a batch file, and the batches it adds, into a compiled batch (see batch.h) that
+ * addBatch loads without parsing. Its printBookings are left out.
+ * @return false, printing the reason, if either file cannot be read or written
+ */
+bool compile_batch(const char* file, const char* compiled);
 
 // void run_all(Vector* queue[], Statistics* stats[], Tracker* trackers []);
-void run_fcfs(Vector* queue, Statistics* stats, Tracker* tracker);
-void run_prio(Vector* queue, Statistics* stats, Tracker* tracker);
-void run_opti(Vector* queue, Statistics* stats, Tracker* tracker);
+/**
+ * @brief Admits the rows from `from` on in table order, after stats and tracker were given the rows before it
+ */
+void run_fcfs(const RequestTable* table, int from, Statistics* stats, Tracker* tracker);
+
+// Every PRIO_CHECKPOINT_INTERVAL requests along its priority order, PRIO saves its state, so that
+// new requests only make it go back to the last checkpoint before the first of them.
+#define PRIO_CHECKPOINT_INTERVAL 256
+
+// Backends that cannot snapshot save a full copy of the tracker per checkpoint. Past this many, every
+// other one is dropped and the interval doubles, so their memory stays bounded while the requests
+// admitted again after a rewind grow to about 2 / PRIO_MAX_COPY_CHECKPOINTS of the order.
+#define PRIO_MAX_COPY_CHECKPOINTS 16
+
+typedef struct PrioCheckpoint {
+    int pos;                // the state before this position of the priority order
+    TrackerSnapshot tracker;
+    int accepted_cnt;
+    int rejected_cnt;
+} PrioCheckpoint;
+
+// What PRIO keeps between runs. Zero-initialize before the first run_prio().
+typedef struct PrioState {
+    IndexList order;                // rows in priority order
+    IndexList scratch;              // for index_list_sort() of order
+    PrioCheckpoint* checkpoints;    // by increasing pos, every `interval` positions
+    int checkpoints_cnt;
+    int checkpoints_capacity;
+    int interval;                   // PRIO_CHECKPOINT_INTERVAL, or a multiple of it once thinned
+} PrioState;
+
+/**
+ * @brief Brings stats and tracker up to date with the rows appended to table since the last run with prio
+ */
+void run_prio(const RequestTable* table, PrioState* prio, Statistics* stats, Tracker* tracker);
+void prio_state_free(PrioState* prio);
+
+// What OPTI keeps between runs. Zero-initialize before the first run_opti().
+typedef struct OptiState {
+    IndexList accepted;     // rows of the best schedule of the last run, which the tracker holds
+    int generation;         // table->size of the last run, 0 before the first
+} OptiState;
+
+/**
+ * @brief Anneals a schedule of every row of table. After the first run, starts from the schedule of the
+ * last one, which the tracker still holds, with the rows appended since then put in greedily
+ */
+void run_opti(const RequestTable* table, OptiState* opti, Statistics* stats, Tracker* tracker);
+void opti_state_free(OptiState* opti);
+
+typedef enum Algorithm {
+    ALGO_FCFS,
+    ALGO_PRIO,
+    ALGO_OPTI,
+    ALGO_COUNT
+} Algorithm;
+
+// "FCFS", "PRIO" or "OPTI"
+const char* algorithm_name(Algorithm algo);
+
+// What a long-lived scheduler keeps between two printBookings: its own copy of the queue, and the
+// result of its algorithm over the first `scheduled` requests of it.
+typedef struct Schedule {
+    Algorithm algo;
+    Vector queue;
+    int scheduled;
+    RequestTable table;     // of queue, as of the last schedule_update()
+    PrioState prio;
+    OptiState opti;
+    Tracker tracker;
+    Statistics stats;
+    Rng rng;                // the generator as OPTI first found it, see schedule_update()
+} Schedule;
+
+void schedule_init(Schedule* schedule, Algorithm algo);
+void schedule_free(Schedule* schedule);
+
+/**
+ * @brief Brings the tracker and statistics up to date with every request of the queue.
+ * Does nothing if no request was appended to the queue since the last call.
+ */
+void schedule_update(Schedule* schedule);
 
 
 #endif //SCHEDULER_H
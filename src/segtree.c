@@ -5,62 +5,130 @@
 #include <limits.h>
 #include <string.h>
 
+#define CACHE_LINE  64
+#define LAZY_NONE   (-1)    // stored values are never negative, so -1 marks "no pending assignment"
+#define LANE_BLOCK  64      // lanes scanned together by the fused free-lane queries
+#define MAX_COVER   64      // canonical nodes of a range are at most 2 * log2(size) + 2
+
+// All K trees live in one arena and are interleaved by node:
+//   tree[p * K + k] is node p of the k-th tree (nodes 1 .. 2 * size - 1, leaves at size .. 2 * size - 1)
+//   lazy[p * K + k] is the pending assignment of internal node p (nodes 1 .. size - 1)
+// Leaves beyond n are padding and stay 0 forever.
 struct SegTree {
     int start;
     int end;
     unsigned K;
-    int** tree;
-    int** lazy;
-    bool** ifLazy;
-    unsigned n;
-    unsigned n4;
+    unsigned n;     // number of real leaves
+    unsigned size;  // number of leaves, rounded up to a power of two
+    unsigned h;     // log2(size)
+    int* tree;
+    int* lazy;
+    size_t bytes;   // size of the arena
+    void* arena;
 };
 
 /* PRIVATE METHODS */
 
-static void maintain(SegTree* st, unsigned k, int cl, int cr, int p) {
-    if (cl == cr) return;
+static size_t arena_bytes(unsigned size, unsigned K) {
+    size_t cells = (size_t)size * 2 * K + (size_t)size * K;
+    size_t bytes = cells * sizeof(int);
+    return (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
 
-    if (st->ifLazy[k][p]) {
-        int left = p * 2;
-        int right = p * 2 + 1;
+static void layout(SegTree* st) {
+    st->tree = (int*)st->arena;
+    st->lazy = st->tree + (size_t)st->size * 2 * st->K;
+}
 
-        st->lazy[k][left] = st->lazy[k][p];
-        st->ifLazy[k][left] = true;
-        st->tree[k][left] = st->lazy[k][p];  // maxed
+static void apply(SegTree* st, unsigned p, unsigned k, int val) {
+    st->tree[(size_t)p * st->K + k] = val;
+    if (p < st->size) st->lazy[(size_t)p * st->K + k] = val;
+}
 
-        st->lazy[k][right] = st->lazy[k][p];
-        st->ifLazy[k][right] = true;
-        st->tree[k][right] = st->lazy[k][p];  // maxed
+// Pushes pending assignments of lane k down along the path from the root to node p (exclusive).
+static void push(SegTree* st, unsigned k, unsigned p) {
+    for (unsigned s = st->h; s > 0; s--) {
+        unsigned i = p >> s;
+        int* lz = &st->lazy[(size_t)i * st->K + k];
+        if (*lz != LAZY_NONE) {
+            apply(st, i * 2, k, *lz);
+            apply(st, i * 2 + 1, k, *lz);
+            *lz = LAZY_NONE;
+        }
+    }
+}
 
-        st->lazy[k][p] = 0;
-        st->ifLazy[k][p] = false;
+// Same as push(), but for all lanes at once.
+static void push_all(SegTree* st, unsigned p) {
+    const unsigned K = st->K;
+    for (unsigned s = st->h; s > 0; s--) {
+        unsigned i = p >> s;
+        int* lz = &st->lazy[(size_t)i * K];
+        int* left = &st->tree[(size_t)i * 2 * K];
+        int* right = left + K;
+        int* left_lz = (i * 2 < st->size) ? &st->lazy[(size_t)i * 2 * K] : NULL;
+        for (unsigned k = 0; k < K; k++) {
+            if (lz[k] == LAZY_NONE) continue;
+            left[k] = right[k] = lz[k];
+            if (left_lz) left_lz[k] = left_lz[K + k] = lz[k];
+            lz[k] = LAZY_NONE;
+        }
     }
 }
 
-static int range_max(SegTree* st, unsigned k, int l, int r, int cl, int cr, int p) {
-    if (l > cr || r < cl) return INT_MIN; // special val 
-    if (l <= cl && cr <= r) return st->tree[k][p];
-    maintain(st, k, cl, cr, p);
-    int cm = cl + (cr - cl) / 2;
-    int left_max = range_max(st, k, l, r, cl, cm, p * 2);
-    int right_max = range_max(st, k, l, r, cm + 1, cr, p * 2 + 1);
-    return (left_max > right_max) ? left_max : right_max;  
+// Recomputes lane k on the path from node p up to the root.
+static void pull(SegTree* st, unsigned k, unsigned p) {
+    const unsigned K = st->K;
+    while (p > 1) {
+        p >>= 1;
+        int lz = st->lazy[(size_t)p * K + k];
+        if (lz != LAZY_NONE) {
+            st->tree[(size_t)p * K + k] = lz;
+        } else {
+            int left = st->tree[(size_t)p * 2 * K + k];
+            int right = st->tree[((size_t)p * 2 + 1) * K + k];
+            st->tree[(size_t)p * K + k] = (left > right) ? left : right;
+        }
+    }
 }
 
-static void range_set(SegTree* st, unsigned k, int l, int r, int val, int cl, int cr, int p) {
-    if (l > cr || r < cl) return;
-    if (l <= cl && cr <= r) {
-        st->lazy[k][p] = val;
-        st->ifLazy[k][p] = true;
-        st->tree[k][p] = val;  
-        return;
+static void max_into(const int* node, int* results, unsigned K) {
+    for (unsigned k = 0; k < K; k++) {
+        results[k] = (node[k] > results[k]) ? node[k] : results[k];
+    }
+}
+
+// Pushes pending assignments along both boundary paths of [l, r] and collects the canonical
+// nodes that cover it. Returns the number of nodes written into cover.
+static unsigned cover(SegTree* st, int l, int r, unsigned cover_nodes[MAX_COVER]) {
+    assert(st->start <= l && l <= r && r <= st->end);
+    unsigned lo = (unsigned)(l - st->start) + st->size;
+    unsigned hi = (unsigned)(r - st->start) + st->size + 1;  // half-open
+    push_all(st, lo);
+    push_all(st, hi - 1);
+    unsigned cnt = 0;
+    for (unsigned a = lo, b = hi; a < b; a >>= 1, b >>= 1) {
+        if (a & 1) cover_nodes[cnt++] = a++;
+        if (b & 1) cover_nodes[cnt++] = --b;
+    }
+    return cnt;
+}
+
+// ORs lanes [k0, k0 + width) of every covering node into busy.
+// Returns false as soon as every lane of the block is known to be busy.
+static bool scan_block(const SegTree* st, const unsigned* nodes, unsigned cnt,
+                       unsigned k0, unsigned width, int busy[LANE_BLOCK]) {
+    for (unsigned k = 0; k < width; k++) busy[k] = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        const int* node = &st->tree[(size_t)nodes[i] * st->K + k0];
+        int all = ~0;
+        for (unsigned k = 0; k < width; k++) {
+            busy[k] |= node[k];
+            all &= -(busy[k] != 0);
+        }
+        if (all) return false;
     }
-    maintain(st, k, cl, cr, p);
-    int cm = cl + (cr - cl) / 2;
-    range_set(st, k, l, r, val, cl, cm, p * 2);
-    range_set(st, k, l, r, val, cm + 1, cr, p * 2 + 1);
-    st->tree[k][p] = (st->tree[k][p * 2] > st->tree[k][p * 2 + 1]) ? st->tree[k][p * 2] : st->tree[k][p * 2 + 1];
+    return true;
 }
 
 /* PUBLIC METHODS */
@@ -68,47 +136,34 @@ static void range_set(SegTree* st, unsigned k, int l, int r, int val, int cl, in
 SegTree* segtree_build(int start, int end, unsigned K) {
     assert(end - start + 1 > 0);
     SegTree* st = (SegTree*)malloc(sizeof(SegTree));
+    if (st == NULL) return NULL;
     st->start = start;
     st->end = end;
     st->K = K;
     st->n = (unsigned)(end - start + 1);
-    st->n4 = st->n * 4;
-    st->tree = (int**)malloc(K * sizeof(int*));
-    st->lazy = (int**)malloc(K * sizeof(int*));
-    st->ifLazy = (bool**)malloc(K * sizeof(bool*));
-    for (unsigned k = 0; k < K; k++) {
-        st->tree[k] = (int*)calloc(st->n4, sizeof(int));
-        st->lazy[k] = (int*)calloc(st->n4, sizeof(int));
-        st->ifLazy[k] = (bool*)calloc(st->n4, sizeof(bool));
+    st->size = 1;
+    st->h = 0;
+    while (st->size < st->n) st->size <<= 1, st->h++;
+    st->bytes = arena_bytes(st->size, K);
+    st->arena = aligned_alloc(CACHE_LINE, st->bytes);
+    if (st->arena == NULL) {
+        free(st);
+        return NULL;
     }
+    layout(st);
+    segtree_empty(st);
     return st;
 }
 
 void segtree_destroy(SegTree* st) {
-    assert(st != NULL);
-    if (st->tree) {
-        for (unsigned k = 0; k < st->K; k++) free(st->tree[k]);
-        free(st->tree);
-    }
-    if (st->lazy) {
-        for (unsigned k = 0; k < st->K; k++) free(st->lazy[k]);
-        free(st->lazy);
-    }
-    if (st->ifLazy) {
-        for (unsigned k = 0; k < st->K; k++) free(st->ifLazy[k]);
-        free(st->ifLazy);
-    }
+    if (st == NULL) return;
+    free(st->arena);
     free(st);
 }
 
 void segtree_empty(SegTree* st) {
-    for (unsigned k = 0; k < st->K; k++) {
-        for (unsigned i = 0; i < st->n4; i++) {
-            st->tree[k][i] = 0;
-            st->lazy[k][i] = 0;
-            st->ifLazy[k][i] = false;
-        }
-    }
+    memset(st->tree, 0, (size_t)st->size * 2 * st->K * sizeof(int));
+    memset(st->lazy, 0xFF, (size_t)st->size * st->K * sizeof(int));  // all bits set == LAZY_NONE
 }
 
 void segtree_range_set(SegTree* st, unsigned k, int l, int r, int val) {
@@ -124,46 +179,76 @@ void segtree_range_set(SegTree* st, unsigned k, int l, int r, int val) {
     }
     */
 
-    range_set(st, k, l, r, val, st->start, st->end, 1);
+    assert(k < st->K && st->start <= l && l <= r && r <= st->end && val >= 0);
+    unsigned lo = (unsigned)(l - st->start) + st->size;
+    unsigned hi = (unsigned)(r - st->start) + st->size + 1;  // half-open
+    push(st, k, lo);
+    push(st, k, hi - 1);
+    for (unsigned a = lo, b = hi; a < b; a >>= 1, b >>= 1) {
+        if (a & 1) apply(st, a++, k, val);
+        if (b & 1) apply(st, --b, k, val);
+    }
+    pull(st, k, lo);
+    pull(st, k, hi - 1);
 }
 
 void segtree_range_query(SegTree* st, int l, int r, int* results) {
-    for (unsigned k = 0; k < st->K; k++) {
-        results[k] = range_max(st, k, l, r, st->start, st->end, 1);  // store max value
+    unsigned nodes[MAX_COVER];
+    unsigned cnt = cover(st, l, r, nodes);
+    for (unsigned k = 0; k < st->K; k++) results[k] = INT_MIN;
+    for (unsigned i = 0; i < cnt; i++) {
+        max_into(&st->tree[(size_t)nodes[i] * st->K], results, st->K);
+    }
+}
+
+int segtree_first_free(SegTree* st, int l, int r) {
+    unsigned nodes[MAX_COVER];
+    unsigned cnt = cover(st, l, r, nodes);
+    int busy[LANE_BLOCK];
+    for (unsigned k0 = 0; k0 < st->K; k0 += LANE_BLOCK) {
+        unsigned width = (st->K - k0 < LANE_BLOCK) ? st->K - k0 : LANE_BLOCK;
+        if (!scan_block(st, nodes, cnt, k0, width, busy)) continue;
+        for (unsigned k = 0; k < width; k++) {
+            if (busy[k] == 0) return (int)(k0 + k);
+        }
+    }
+    return -1;
+}
+
+void segtree_free_mask(SegTree* st, int l, int r, unsigned long long* mask) {
+    unsigned nodes[MAX_COVER];
+    unsigned cnt = cover(st, l, r, nodes);
+    int busy[LANE_BLOCK];
+    for (unsigned k0 = 0; k0 < st->K; k0 += LANE_BLOCK) {
+        unsigned width = (st->K - k0 < LANE_BLOCK) ? st->K - k0 : LANE_BLOCK;
+        unsigned long long word = 0;
+        if (scan_block(st, nodes, cnt, k0, width, busy)) {
+            for (unsigned k = 0; k < width; k++) {
+                if (busy[k] == 0) word |= 1ULL << k;
+            }
+        }
+        mask[k0 / LANE_BLOCK] = word;
     }
 }
 
 void segtree_overwrite(SegTree* source, SegTree* target) {
     assert(source && target);
 
-    // free existing data in target
-    for (unsigned k = 0; k < target->K; k++) {
-        free(target->tree[k]);
-        free(target->lazy[k]);
-        free(target->ifLazy[k]);
+    if (target->bytes != source->bytes) {
+        free(target->arena);
+        target->arena = aligned_alloc(CACHE_LINE, source->bytes);
+        assert(target->arena != NULL);
     }
-    free(target->tree);
-    free(target->lazy);
-    free(target->ifLazy);
 
     // copy params source -> target
     target->start = source->start;
     target->end = source->end;
     target->K = source->K;
     target->n = source->n;
-    target->n4 = source->n4;
-
-    // allocate new space
-    target->tree = (int**)malloc(source->K * sizeof(int*));
-    target->lazy = (int**)malloc(source->K * sizeof(int*));
-    target->ifLazy = (bool**)malloc(source->K * sizeof(bool*));
-
-    for (unsigned k = 0; k < source->K; k++) {
-        target->tree[k] = (int*)malloc(source->n4 * sizeof(int));
-        target->lazy[k] = (int*)malloc(source->n4 * sizeof(int));
-        target->ifLazy[k] = (bool*)malloc(source->n4 * sizeof(bool));
-        memcpy(target->ifLazy[k], source->ifLazy[k], source->n4 * sizeof(bool));
-        memcpy(target->tree[k], source->tree[k], source->n4 * sizeof(int));
-        memcpy(target->lazy[k], source->lazy[k], source->n4 * sizeof(int));
-    }
+    target->size = source->size;
+    target->h = source->h;
+    target->bytes = source->bytes;
+    layout(target);
+
+    memcpy(target->arena, source->arena, source->bytes);
 }
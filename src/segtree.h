@@ -3,6 +3,8 @@
 
 /**
  * Opaque handle representing K parallel segment trees.
+ * All K trees share one cache-line-aligned arena with lanes interleaved by node,
+ * so a copy of the whole structure is a single memcpy.
  * Use public interface below for interactions.
  */
 typedef struct SegTree SegTree;
@@ -54,7 +56,31 @@ void segtree_range_set(SegTree* st, unsigned k, int l, int r, int val);
 void segtree_range_query(SegTree* st, int l, int r, int* results);
 
 /**
- * Overwrites the contents of target segment tree with source
+ * Finds the lowest-indexed instance that is entirely free (all zero) on [l, r].
+ *                  Visits [l, r] once for all K instances and stops scanning
+ *                  as soon as the answer is certain.
+ *
+ * @param st        Handle from segtree_build()
+ * @param l         Left query boundary (inclusive)
+ * @param r         Right query boundary (inclusive)
+ * @return          Index of the first free instance, -1 if every instance is occupied
+ */
+int segtree_first_free(SegTree* st, int l, int r);
+
+/**
+ * Computes the set of instances that are entirely free (all zero) on [l, r].
+ *
+ * @param st        Handle from segtree_build()
+ * @param l         Left query boundary (inclusive)
+ * @param r         Right query boundary (inclusive)
+ * @param mask      Pre-allocated output bitmask of (K + 63) / 64 words.
+ *                  Bit k % 64 of word k / 64 is set iff instance k is free.
+ */
+void segtree_free_mask(SegTree* st, int l, int r, unsigned long long* mask);
+
+/**
+ * Overwrites the contents of target segment tree with source.
+ * Reuses the arena of target when both trees have the same shape.
  * 
  * @param source    Source segment tree to copy from
  * @param target    Target segment tree to copy to
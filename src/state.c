@@ -2,14 +2,249 @@
 #include "utils.h"
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* BACKENDS */
+
+static void* dense_build(int start, int end, unsigned K) { return pagedtree_build(start, end, K); }
+static void dense_destroy(void* idx) { pagedtree_destroy(idx); }
+static void dense_empty(void* idx) { pagedtree_empty(idx); }
+static void dense_range_set(void* idx, unsigned k, int l, int r, int val) { pagedtree_range_set(idx, k, l, r, val); }
+static void dense_range_query(void* idx, int l, int r, int* results) { pagedtree_range_query(idx, l, r, results); }
+static int dense_first_free(void* idx, int l, int r) { return pagedtree_first_free(idx, l, r); }
+static void dense_overwrite(void* source, void* target) { pagedtree_overwrite(source, target); }
+
+static const TrackerOps dense_ops = {
+    .build = dense_build,
+    .destroy = dense_destroy,
+    .empty = dense_empty,
+    .range_set = dense_range_set,
+    .range_query = dense_range_query,
+    .first_free = dense_first_free,
+    .overwrite = dense_overwrite,
+};
+
+static void* persistent_build(int start, int end, unsigned K) { return psegtree_build(start, end, K); }
+static void persistent_destroy(void* idx) { psegtree_destroy(idx); }
+static void persistent_empty(void* idx) { psegtree_empty(idx); }
+static void persistent_range_set(void* idx, unsigned k, int l, int r, int val) { psegtree_range_set(idx, k, l, r, val); }
+static void persistent_range_query(void* idx, int l, int r, int* results) { psegtree_range_query(idx, l, r, results); }
+static int persistent_first_free(void* idx, int l, int r) { return psegtree_first_free(idx, l, r); }
+static void persistent_overwrite(void* source, void* target) { psegtree_overwrite(source, target); }
+static unsigned persistent_snapshot(void* idx) { return psegtree_snapshot(idx); }
+static void persistent_restore(void* idx, unsigned version) { psegtree_restore(idx, version); }
+static bool persistent_should_collect(void* idx) { return psegtree_should_collect(idx); }
+static void persistent_collect(void* idx, unsigned* live, unsigned n_live) { psegtree_collect(idx, live, n_live); }
+
+static const TrackerOps persistent_ops = {
+    .build = persistent_build,
+    .destroy = persistent_destroy,
+    .empty = persistent_empty,
+    .range_set = persistent_range_set,
+    .range_query = persistent_range_query,
+    .first_free = persistent_first_free,
+    .overwrite = persistent_overwrite,
+    .snapshot = persistent_snapshot,
+    .restore = persistent_restore,
+    .should_collect = persistent_should_collect,
+    .collect = persistent_collect,
+};
+
+static void* sparse_build(int start, int end, unsigned K) { return intervalset_build(start, end, K); }
+static void sparse_destroy(void* idx) { intervalset_destroy(idx); }
+static void sparse_empty(void* idx) { intervalset_empty(idx); }
+static void sparse_range_set(void* idx, unsigned k, int l, int r, int val) { intervalset_range_set(idx, k, l, r, val); }
+static void sparse_range_query(void* idx, int l, int r, int* results) { intervalset_range_query(idx, l, r, results); }
+static int sparse_first_free(void* idx, int l, int r) { return intervalset_first_free(idx, l, r); }
+static void sparse_overwrite(void* source, void* target) { intervalset_overwrite(source, target); }
+
+static const TrackerOps sparse_ops = {
+    .build = sparse_build,
+    .destroy = sparse_destroy,
+    .empty = sparse_empty,
+    .range_set = sparse_range_set,
+    .range_query = sparse_range_query,
+    .first_free = sparse_first_free,
+    .overwrite = sparse_overwrite,
+};
+
+// The counting backend only knows how many instances are busy at each minute. It admits a booking
+// whenever fewer than K instances are busy during all of it, even if no single instance is free
+// throughout, since bookings are renumbered by assign_slots() afterwards. So it may accept more
+// than the other backends. Instance numbers are virtual: first_free() returns the number of busy instances, any write of a non-zero
+// value books one instance on [l, r] and a write of 0 releases one. This is exactly how try_put(),
+// try_delete() and the journal use range_set(). range_query() reports results[k] = 1 iff more than
+// k instances are busy at some minute of [l, r].
+static void* counting_build(int start, int end, unsigned K) { return counttree_build(start, end, K); }
+static void counting_destroy(void* idx) { counttree_destroy(idx); }
+static void counting_empty(void* idx) { counttree_empty(idx); }
+static void counting_range_set(void* idx, unsigned k, int l, int r, int val) {
+    (void)k;
+    counttree_range_add(idx, l, r, val ? 1 : -1);
+}
+static void counting_range_query(void* idx, int l, int r, int* results) {
+    int busy = counttree_range_max(idx, l, r);
+    for (unsigned k = 0; k < counttree_capacity(idx); k++) results[k] = ((int)k < busy);
+}
+static int counting_first_free(void* idx, int l, int r) { return counttree_first_free(idx, l, r); }
+static void counting_overwrite(void* source, void* target) { counttree_overwrite(source, target); }
+static int counting_find(void* idx, int l, int r, int val) {
+    (void)idx, (void)l, (void)r, (void)val;
+    return 0;
+}
+
+static const TrackerOps counting_ops = {
+    .build = counting_build,
+    .destroy = counting_destroy,
+    .empty = counting_empty,
+    .range_set = counting_range_set,
+    .range_query = counting_range_query,
+    .first_free = counting_first_free,
+    .overwrite = counting_overwrite,
+    .find = counting_find,
+};
+
+// The differential backend keeps one index of every other backend and checks that the
+// persistent and sparse ones always answer exactly like the dense (paged SegTree) reference.
+// The counting one may admit more: the others keep every booking on the instance it was given,
+// while it only needs some assignment to exist. It must admit whatever the reference admits.
+#define DIFF_MEMBERS    4
+#define DIFF_EXACT      3   // members before this one report every instance
+
+typedef struct DiffIndex {
+    unsigned K;
+    void* idx[DIFF_MEMBERS];
+} DiffIndex;
+
+static const TrackerOps* const diff_members[DIFF_MEMBERS] = {&dense_ops, &persistent_ops, &sparse_ops, &counting_ops};
+static const char* const diff_names[DIFF_MEMBERS] = {"dense", "persistent", "sparse", "counting"};
+
+static void diff_fail(const char* op, unsigned member, int l, int r) {
+    fprintf(stderr, "Tracker backends disagree: %s [%d, %d] of %s differs from dense\n",
+            op, l, r, diff_names[member]);
+    abort();
+}
+
+static void* diff_build(int start, int end, unsigned K) {
+    DiffIndex* d = malloc(sizeof(DiffIndex));
+    d->K = K;
+    for (unsigned i = 0; i < DIFF_MEMBERS; i++) d->idx[i] = diff_members[i]->build(start, end, K);
+    return d;
+}
+
+static void diff_destroy(void* idx) {
+    DiffIndex* d = idx;
+    for (unsigned i = 0; i < DIFF_MEMBERS; i++) diff_members[i]->destroy(d->idx[i]);
+    free(d);
+}
+
+static void diff_empty(void* idx) {
+    DiffIndex* d = idx;
+    for (unsigned i = 0; i < DIFF_MEMBERS; i++) diff_members[i]->empty(d->idx[i]);
+}
+
+static void diff_range_set(void* idx, unsigned k, int l, int r, int val) {
+    DiffIndex* d = idx;
+    for (unsigned i = 0; i < DIFF_MEMBERS; i++) diff_members[i]->range_set(d->idx[i], k, l, r, val);
+}
+
+static void diff_range_query(void* idx, int l, int r, int* results) {
+    DiffIndex* d = idx;
+    int other[d->K];
+    diff_members[0]->range_query(d->idx[0], l, r, results);
+    for (unsigned i = 1; i < DIFF_EXACT; i++) {
+        diff_members[i]->range_query(d->idx[i], l, r, other);
+        if (memcmp(results, other, d->K * sizeof(int)) != 0) diff_fail("range_query", i, l, r);
+    }
+}
+
+static int diff_first_free(void* idx, int l, int r) {
+    DiffIndex* d = idx;
+    int k = diff_members[0]->first_free(d->idx[0], l, r);
+    for (unsigned i = 1; i < DIFF_MEMBERS; i++) {
+        int other = diff_members[i]->first_free(d->idx[i], l, r);
+        if (i < DIFF_EXACT ? other != k : (k >= 0 && other < 0)) diff_fail("first_free", i, l, r);
+    }
+    return k;
+}
+
+static void diff_overwrite(void* source, void* target) {
+    DiffIndex* s = source;
+    DiffIndex* t = target;
+    for (unsigned i = 0; i < DIFF_MEMBERS; i++) diff_members[i]->overwrite(s->idx[i], t->idx[i]);
+}
+
+static const TrackerOps diff_ops = {
+    .build = diff_build,
+    .destroy = diff_destroy,
+    .empty = diff_empty,
+    .range_set = diff_range_set,
+    .range_query = diff_range_query,
+    .first_free = diff_first_free,
+    .overwrite = diff_overwrite,
+};
+
+static const TrackerOps* const backend_ops[] = {
+    [TRACKER_DENSE] = &dense_ops,
+    [TRACKER_PERSISTENT] = &persistent_ops,
+    [TRACKER_SPARSE] = &sparse_ops,
+    [TRACKER_COUNTING] = &counting_ops,
+    [TRACKER_DIFF] = &diff_ops,
+};
+
+static const char* const backend_names[] = {
+    [TRACKER_DENSE] = "dense",
+    [TRACKER_PERSISTENT] = "persistent",
+    [TRACKER_SPARSE] = "sparse",
+    [TRACKER_COUNTING] = "counting",
+    [TRACKER_DIFF] = "diff",
+};
+
+static TrackerBackend default_backend = TRACKER_DENSE;
+static bool backend_forced = false;
+
+/* TRACKER */
+
+void tracker_set_default_backend(TrackerBackend backend) {
+    default_backend = backend;
+    backend_forced = true;
+}
+
+TrackerBackend tracker_preferred_backend(bool wants_snapshots) {
+    if (backend_forced) return default_backend;
+    return wants_snapshots ? TRACKER_PERSISTENT : TRACKER_DENSE;
+}
+
+bool tracker_parse_backend(const char* name, TrackerBackend* backend) {
+    for (unsigned i = 0; i < sizeof(backend_names) / sizeof(backend_names[0]); i++) {
+        if (strcmp(name, backend_names[i]) == 0) {
+            *backend = (TrackerBackend)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool tracker_can_snapshot(const Tracker* tr) {
+    return tr->ops->snapshot != NULL;
+}
 
 void init_tracker(Tracker* tr) {
-    int start = parse_time("2025-05-10", "00:00");
-    int end = parse_time("2025-05-16", "23:59");
-    tr->lu = segtree_build(start, end, 3);              // 3 locker + umbrella
-    tr->bc = segtree_build(start, end, 3);              // 3 battery + cable
-    tr->vi = segtree_build(start, end, 3);              // 3 valet parking + inflation services
-    tr->park = segtree_build(start, end,  10);          // 10 parking slots
+    init_tracker_backend(tr, tracker_preferred_backend(false));
+}
+
+void init_tracker_backend(Tracker* tr, TrackerBackend backend) {
+    int start = 0;
+    int end = horizon_minutes() - 1;
+    tr->backend = backend;
+    tr->ops = backend_ops[backend];
+    tr->journal = NULL;
+    tr->n_resources = resource_count();
+    for (unsigned r = 0; r < tr->n_resources; r++) {
+        tr->index[r] = tr->ops->build(start, end, resource_get(r)->capacity);
+        tr->busy[r] = 0;
+    }
 }
 
 void init_statistics(Statistics* stats) {
@@ -24,17 +259,77 @@ void reset_statistics(Statistics* stats) {
 }
 
 void reset_tracker(Tracker* tr) {
-    segtree_destroy(tr->lu);
-    segtree_destroy(tr->bc);
-    segtree_destroy(tr->vi);
-    segtree_destroy(tr->park);
-    init_tracker(tr);
+    for (unsigned r = 0; r < tr->n_resources; r++) {
+        tr->ops->empty(tr->index[r]);
+        tr->busy[r] = 0;
+    }
+}
+
+void free_tracker(Tracker* tr) {
+    for (unsigned r = 0; r < tr->n_resources; r++) tr->ops->destroy(tr->index[r]);
 }
 
 void tracker_overwrite(Tracker* source, Tracker* target) {
-    assert(source && target);
-    segtree_overwrite(source->lu, target->lu);
-    segtree_overwrite(source->bc, target->bc);
-    segtree_overwrite(source->vi, target->vi);
-    segtree_overwrite(source->park, target->park);
-}
\ No newline at end of file
+    assert(source && target && source->ops == target->ops && source->n_resources == target->n_resources);
+    for (unsigned r = 0; r < source->n_resources; r++) {
+        source->ops->overwrite(source->index[r], target->index[r]);
+        target->busy[r] = source->busy[r];
+    }
+}
+
+double tracker_utilization(const Tracker* tr, unsigned r) {
+    return (double)tr->busy[r] / ((double)horizon_minutes() * resource_get(r)->capacity);
+}
+
+double tracker_total_utilization(const Tracker* tr) {
+    long long busy = 0;
+    for (unsigned r = 0; r < tr->n_resources; r++) busy += tr->busy[r];
+    return (double)busy / ((double)horizon_minutes() * resource_total_capacity());
+}
+
+void tracker_snapshot(Tracker* tr, TrackerSnapshot* snap) {
+    if (!tracker_can_snapshot(tr)) {
+        if (snap->copy == NULL) {
+            snap->copy = malloc(sizeof(Tracker));
+            init_tracker_backend(snap->copy, tr->backend);
+        }
+        tracker_overwrite(tr, snap->copy);
+        return;
+    }
+    for (unsigned r = 0; r < tr->n_resources; r++) {
+        snap->version[r] = tr->ops->snapshot(tr->index[r]);
+        snap->busy[r] = tr->busy[r];
+    }
+}
+
+void tracker_restore(Tracker* tr, const TrackerSnapshot* snap) {
+    if (!tracker_can_snapshot(tr)) {
+        assert(snap->copy != NULL);
+        tracker_overwrite(snap->copy, tr);
+        return;
+    }
+    for (unsigned r = 0; r < tr->n_resources; r++) {
+        tr->ops->restore(tr->index[r], snap->version[r]);
+        tr->busy[r] = snap->busy[r];
+    }
+}
+
+void tracker_free_snapshot(TrackerSnapshot* snap) {
+    if (snap->copy) {
+        free_tracker(snap->copy);
+        free(snap->copy);
+        snap->copy = NULL;
+    }
+}
+
+void tracker_collect(Tracker* tr, TrackerSnapshot* live[], unsigned n_live) {
+    if (tr->ops->collect == NULL) return;
+    unsigned versions[n_live + 1];
+
+    for (unsigned r = 0; r < tr->n_resources; r++) {
+        if (!tr->ops->should_collect(tr->index[r])) continue;
+        for (unsigned i = 0; i < n_live; i++) versions[i] = live[i]->version[r];
+        tr->ops->collect(tr->index[r], versions, n_live);
+        for (unsigned i = 0; i < n_live; i++) live[i]->version[r] = versions[i];
+    }
+}
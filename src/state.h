@@ -3,6 +3,13 @@
 
 #include "vector.h"
 #include "segtree.h"
+#include "pagedtree.h"
+#include "psegtree.h"
+#include "intervalset.h"
+#include "counttree.h"
+#include "resource.h"
+
+#include <stdbool.h>
 
 // The Statistics struct keeps track of accepted and rejected requests.
 // Each scheduling algorithm should have exactly one Statistics instance.
@@ -15,20 +22,94 @@ typedef struct Statistics {
 } Statistics;
 
 
+// The backends a Tracker can keep its occupancy in.
+typedef enum TrackerBackend {
+    TRACKER_DENSE,          // PagedTree: a flat SegTree per day, allocated on first write, shared until written
+    TRACKER_PERSISTENT,     // PSegTree: path copying, O(1) snapshot and restore
+    TRACKER_SPARSE,         // IntervalSet: ordered sets of occupied intervals, sized by the bookings
+    TRACKER_COUNTING,       // CountTree: busy slots per minute only, admission cost independent of capacity;
+                            // admits any booking some slot numbering can fit, so may accept more
+    TRACKER_DIFF            // runs every operation on all of the above and aborts if they disagree
+} TrackerBackend;
+
+// Operations a Tracker backend provides for one resource type with K instances.
+// Every call takes the index structure returned by build().
+// snapshot, restore, should_collect and collect are NULL for backends that cannot snapshot.
+// find is NULL for backends whose range_query reports the value of every instance;
+// backends that do not track instances (TRACKER_COUNTING) provide it instead.
+typedef struct TrackerOps {
+    void* (*build)(int start, int end, unsigned K);
+    void (*destroy)(void* idx);
+    void (*empty)(void* idx);
+    void (*range_set)(void* idx, unsigned k, int l, int r, int val);
+    void (*range_query)(void* idx, int l, int r, int* results);
+    int (*first_free)(void* idx, int l, int r);
+    void (*overwrite)(void* source, void* target);
+    int (*find)(void* idx, int l, int r, int val);     // instance holding val on [l, r]
+
+    unsigned (*snapshot)(void* idx);
+    void (*restore)(void* idx, unsigned version);
+    bool (*should_collect)(void* idx);
+    void (*collect)(void* idx, unsigned* live, unsigned n_live);
+} TrackerOps;
+
+// See journal.h
+typedef struct Journal Journal;
+
 // The Tracker struct keeps track of the occupied time ranges for each resource.
 // Each scheduling algorithm should have exactly one Tracker instance.
 // This struct shall be modified in try_put() and try_essential().
 typedef struct Tracker {
-    SegTree* bc;    // battery + cable (0)
-    SegTree* lu;    // locker + umbrella (1)
-    SegTree* vi;    // valet parking + inflation services (2)
-    SegTree* park;  // parking slots
+    TrackerBackend backend;
+    const TrackerOps* ops;
+    Journal* journal;   // if not NULL, try_put() and try_delete() log their writes here
+    unsigned n_resources;
+    void* index[MAX_RESOURCES];     // index[r] holds the resource_get(r)->capacity slots of resource r
+    long long busy[MAX_RESOURCES];  // booked minutes of resource r, summed over its slots
 } Tracker;
 
+// A saved state of a Tracker. Zero-initialize before the first tracker_snapshot().
+// For backends that can snapshot (TRACKER_PERSISTENT) taking and restoring one is O(1).
+// Other backends fall back to a full copy kept in `copy`.
+typedef struct TrackerSnapshot {
+    unsigned version[MAX_RESOURCES];
+    long long busy[MAX_RESOURCES];
+    struct Tracker* copy;
+} TrackerSnapshot;
+
+// init_tracker() uses tracker_preferred_backend(false).
 void init_tracker(Tracker* tr);
+void init_tracker_backend(Tracker* tr, TrackerBackend backend);
+
+// Forces every tracker to use the given backend (selected at startup).
+void tracker_set_default_backend(TrackerBackend backend);
+
+// The backend chosen at startup, or else TRACKER_PERSISTENT for users that snapshot a lot
+// and TRACKER_DENSE for everyone else.
+TrackerBackend tracker_preferred_backend(bool wants_snapshots);
+
+// Parses "dense", "persistent", "sparse", "counting" or "diff". Returns false if the name is unknown.
+bool tracker_parse_backend(const char* name, TrackerBackend* backend);
+bool tracker_can_snapshot(const Tracker* tr);
 void init_statistics(Statistics* stats);
 void reset_statistics(Statistics* stats);
 void reset_tracker(Tracker* tr);
+void free_tracker(Tracker* tr);
 void tracker_overwrite(Tracker* source, Tracker* target);
 
+// Fraction of the horizon resource r is booked for, averaged over its slots. O(1).
+double tracker_utilization(const Tracker* tr, unsigned r);
+
+// Fraction of the horizon booked over all resources, weighted by their capacity. O(resources).
+double tracker_total_utilization(const Tracker* tr);
+
+void tracker_snapshot(Tracker* tr, TrackerSnapshot* snap);
+void tracker_restore(Tracker* tr, const TrackerSnapshot* snap);
+void tracker_free_snapshot(TrackerSnapshot* snap);
+
+// Reclaims the nodes that neither the current state nor any of the live snapshots can reach,
+// if there are enough of them. Snapshots not listed in live become invalid.
+// No-op for backends that cannot snapshot.
+void tracker_collect(Tracker* tr, TrackerSnapshot* live[], unsigned n_live);
+
 #endif //STATE_H
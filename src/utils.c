@@ -4,6 +4,7 @@
 //
 
 #include "utils.h"
+#include "journal.h"
 
 #include <assert.h>
 
@@ -40,11 +41,11 @@ char** split(const char* str) {
     int param_i = 0, j = 0;
     for (int i = 0; str[i]; i++) {
         if (str[i] == ' ') {
-            if (param_i >= 8) break;
+            if (param_i >= 7) break; // only 8 tokens
             else param_i++, j = 0;
             continue;
         }
-        res[param_i][j++] = str[i];
+        if (j < 99) res[param_i][j++] = str[i]; // keep the '\0' of the 100-byte token
     }
     return res;
 }
@@ -80,53 +81,174 @@ bool compare(const char* str1, const char* str2) {
 }
 
 
+/* HORIZON */
+
+// The horizon is a run of whole days. Minute 0 is 00:00 of its first day.
+static int horizon_first_day = 20218;   // 2025-05-10, in days since 1970-01-01
+static int horizon_days = 7;            // up to 2025-05-16
+
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's algorithm).
+static int days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yoe = year - era * 400;
+    const int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int days, int* year, int* month, int* day) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const int doe = days - era * 146097;
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+// Days since 1970-01-01 of year-month-day. Returns false if it is not a real date.
+static bool valid_date_days(int year, int month, int day, int* days) {
+    static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1 || year > 9999 || month < 1 || month > 12) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (day < 1 || day > month_days[month - 1] + (month == 2 && leap)) return false;
+    *days = days_from_civil(year, month, day);
+    return true;
+}
+
+// Parses YYYY-MM-DD into days since 1970-01-01. Returns false if it is not a real date.
+static bool parse_date(const char* date, int* days) {
+    int year, month, day;
+    if (sscanf(date, "%d-%d-%d", &year, &month, &day) != 3) return false;
+    return valid_date_days(year, month, day, days);
+}
+
+bool set_horizon(const char* first, const char* last) {
+    int first_day, last_day;
+    if (!parse_date(first, &first_day) || !parse_date(last, &last_day)) return false;
+    if (last_day < first_day || last_day - first_day + 1 > MAX_HORIZON_DAYS) return false;
+    horizon_first_day = first_day;
+    horizon_days = last_day - first_day + 1;
+    return true;
+}
+
+int horizon_minutes(void) {
+    return horizon_days * 24 * 60;
+}
+
+int horizon_start_day(void) {
+    return horizon_first_day;
+}
+
+void format_date(int minutes, char date[DATE_STRING_LEN]) {
+    int year, month, day;
+    civil_from_days(horizon_first_day + minutes / (24 * 60), &year, &month, &day);
+    snprintf(date, DATE_STRING_LEN, "%04u-%02u-%02u",
+             (unsigned)year % 10000, (unsigned)month % 100, (unsigned)day % 100);
+}
+
+
 /* INPUT PARSING */
 
-int parse_time(const char* date, const char* time) {
+// Fast paths for the fixed formats every batch file uses. Anything else goes to sscanf(), which
+// also accepts e.g. "2025-5-1" or "9:05", through a NUL-terminated copy of the token.
+
+static bool is_digits(const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    return true;
+}
+
+static int digits_value(const char* s, size_t n) {
+    int value = 0;
+    for (size_t i = 0; i < n; i++) value = value * 10 + (s[i] - '0');
+    return value;
+}
+
+static void view_copy(StringView view, char buffer[ARG_LEN]) {
+    size_t len = view.len < ARG_LEN - 1 ? view.len : ARG_LEN - 1;
+    memcpy(buffer, view.data, len);
+    buffer[len] = '\0';
+}
+
+int parse_time(StringView date, StringView time) {
     // date format: YYYY-MM-DD
     // time format: hh:mm
-    // return the time in minutes
-    // error handling: return -1 if 
-    //      1. the date         const char ccc[] = tokens[6];
-    //      2. wrong format, 
-    //      3. or not within range of 2025-05-10 ~ 2025-05-16
-
-    int year, month, day, hour, minute;
-    
-    if (sscanf(date, "%d-%d-%d", &year, &month, &day) != 3 ||
-        sscanf(time, "%d:%d", &hour, &minute) != 2)
-        return -1;
-    
-    if (year != 2025 || month != 5 || day < 10 || day > 16 ||
+    // return the time in minutes since the start of the horizon
+    // error handling: return -1 if
+    //      1. the date does not exist,
+    //      2. wrong format,
+    //      3. or not within the horizon (see set_horizon())
+
+    int days, hour, minute;
+    const char* d = date.data;
+    const char* t = time.data;
+
+    if (date.len == 10 && d[4] == '-' && d[7] == '-' &&
+        is_digits(d, 4) && is_digits(d + 5, 2) && is_digits(d + 8, 2)) {
+        if (!valid_date_days(digits_value(d, 4), digits_value(d + 5, 2), digits_value(d + 8, 2), &days)) return -1;
+    } else {
+        char copy[ARG_LEN];
+        view_copy(date, copy);
+        if (!parse_date(copy, &days)) return -1;
+    }
+
+    if (time.len == 5 && t[2] == ':' && is_digits(t, 2) && is_digits(t + 3, 2)) {
+        hour = digits_value(t, 2);
+        minute = digits_value(t + 3, 2);
+    } else {
+        char copy[ARG_LEN];
+        view_copy(time, copy);
+        if (sscanf(copy, "%d:%d", &hour, &minute) != 2) return -1;
+    }
+
+    days -= horizon_first_day;
+    if (days < 0 || days >= horizon_days ||
         hour < 0 || hour > 23 || minute < 0 || minute > 59)
         return -1;
-    
-    return ((day - 10) * 24 + hour) * 60 + minute;
+
+    return (days * 24 + hour) * 60 + minute;
 }
 
-int parse_duration(const char* duration) {
+int parse_duration(StringView duration) {
     // duration format: n.n
     // return the duration in minutes
     // error handling: return -1 if
-    //      1. the duration is invalid
+    //      1. the duration is invalid (shorter than a minute)
     //      2. wrong format
 
     float hours;
-    if (sscanf(duration, "%f", &hours) != 1) return -1;
-    if (hours <= 0) return -1;
-    return (int)(hours * 60);
+    const char* s = duration.data;
+    size_t n = duration.len;
+    size_t whole = n >= 2 && s[n - 2] == '.' ? n - 2 : n;
+
+    if (whole >= 1 && whole <= 6 && is_digits(s, whole) && (whole == n || is_digits(s + n - 1, 1))) {
+        // the float nearest to n.n, as sscanf() reads it
+        int tenths = digits_value(s, whole) * 10 + (whole == n ? 0 : s[n - 1] - '0');
+        hours = (float)(tenths / 10.0);
+    } else {
+        char copy[ARG_LEN];
+        view_copy(duration, copy);
+        if (sscanf(copy, "%f", &hours) != 1) return -1;
+    }
+    int minutes = (int)(hours * 60);
+    return (minutes > 0) ? minutes : -1;
 }
 
-char parse_member(const char* member) {
+char parse_member(StringView member) {
     // member format: '-member_A', '-member_B', '-member_C', '-member_D', '-member_E'
     // return the member 'A', 'B', 'C' ... in char
     // error handling: return 0 if
     //      1. member other than A, B, C, D, E.
     //      2. wrong format (Expected format: "memberX" where X is A-E)
 
-    if (strlen(member) != 9 || strncmp(member, "-member_", 8) != 0) return 0;
-    char member_char = member[8];
-    if (member_char < 'A' || member_char > 'E' || member[9] != '\0') return 0;
+    if (member.len != 9 || strncmp(member.data, "-member_", 8) != 0) return 0;
+    char member_char = member.data[8];
+    if (member_char < 'A' || member_char > 'E') return 0;
     return member_char;
 
 }
@@ -156,131 +278,194 @@ const char* get_valid_pair(const char* essential) {
     return NULL;
 }
 
-bool is_valid_essentials(const char* essential) {
+bool is_valid_essentials(StringView essential) {
     // return true if provided essential is valid, false otherwise
-    // valid essentials are: battery, cable, locker, umbrella, InflationService, valetPark
-
-    if (compare(essential, "battery")) return true;
-    if (compare(essential, "cable") || compare(essential, "cables")) return true;
-    if (compare(essential, "locker")) return true;
-    if (compare(essential, "umbrella")) return true;
-    if (compare(essential, "InflationService") || compare(essential, "inflation")) return true;
-    if (compare(essential, "valetPark") || compare(essential, "valet")) return true;
-    return false;
+    // valid essentials are the item names of the resource registry,
+    // by default: battery, cable, locker, umbrella, InflationService, valetPark
+
+    return resource_lookup_n(essential.data, essential.len) >= 0;
 }
 
-void add_essential_value(char* original_code, const char* essential) {
-    // struct Request object uses binary to represent the requested essential items
-    // It uses 3 bit binary, each bit represent [battery + cable], [locker + umbrella], [inflation service + valet parking] respectively
-    // E.g., 0b011 = (battery + cable) + (inflation + valet);
-    // this function updates the binary code based on the given
+void add_essential_value(ResourceMask* resources, StringView essential) {
+    // struct Request object uses one bit per resource of the registry to represent the requested items
+    // E.g., "battery" and "cable" both set the bit of the battery + cable resource
+    // this function updates the mask based on the given item, and ignores unknown or empty items
 
-    if (compare(essential, "battery") || compare(essential, "cable") || compare(essential, "cables")) *original_code |= 0b100;
-    if (compare(essential, "locker") || compare(essential, "umbrella")) *original_code |= 0b010;
-    if (compare(essential, "InflationService") || compare(essential, "valetPark")) *original_code |= 0b001;
-    if (compare(essential, "inflation") || compare(essential, "valet")) *original_code |= 0b001;
+    int r = resource_lookup_n(essential.data, essential.len);
+    if (r >= 0) *resources |= RESOURCE_BIT(r);
+}
+
+uint32_t hash_lowercase(const char* s, size_t len, uint32_t seed) {
+    // FNV-1a of the ASCII-lowercased bytes
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 'A' && c <= 'Z') c = (unsigned char)(c + ('a' - 'A'));
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
 }
 
-int get_priority(const char* type) {
-    // priority: Event > Reservation > Parking > Essentials
-    // use convention: priority value smaller is higher priority
-    // return the priority value based on the given type
+bool equals_lowercase(const char* s, size_t len, const char* lower) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 'A' && c <= 'Z') c = (unsigned char)(c + ('a' - 'A'));
+        if (lower[i] != (char)c) return false;  // also stops at the end of lower
+    }
+    return lower[len] == '\0';
+}
 
-    if (compare(type, "addEvent")) return 0;
-    if (compare(type, "addReservation")) return 1;
-    if (compare(type, "addParking")) return 2;
-    if (compare(type, "bookEssentials")) return 3;
-    return 4;
+// Assigns val to [l, r] of instance k of resource res and updates tracker->busy[res].
+// Logs the write if the tracker is journaled.
+static void tracker_write(Tracker* tracker, unsigned res, unsigned k, int l, int r, int val, int prev) {
+    if (tracker->journal) journal_log_write(tracker->journal, res, k, l, r, prev);
+    tracker->ops->range_set(tracker->index[res], k, l, r, val);
+    tracker->busy[res] += (val ? 1 : -1) * (long long)(r - l + 1);
 }
 
 // Try to response a request.
 // This function will process both parking request and essential request(s).
-bool try_put(int order, int start, int end, bool parking, char essential, Tracker* tracker) {
+bool try_put(int order, int start, int end, ResourceMask resources, Tracker* tracker) {
     assert(order > 0);
-    unsigned pk = 999, ek[3];
-    ek[0] = ek[1] = ek[2] = 999;
+    unsigned slot[MAX_RESOURCES];
 
-	/* TRY PARKING */
+    for (ResourceMask m = resources; m; m &= m - 1) {
+        unsigned r = resource_mask_first(m);
+        int k = tracker->ops->first_free(tracker->index[r], start, end);
+        if (k < 0) return false;
+        slot[r] = (unsigned)k;
+    }
+
+    for (ResourceMask m = resources; m; m &= m - 1) {
+        unsigned r = resource_mask_first(m);
+        tracker_write(tracker, r, slot[r], start, end, order, 0);
+    }
 
-	if (parking) {
-		int buffer[10];
-		segtree_range_query(tracker->park, start, end, buffer);
-		for (unsigned k = 0; k < 10; k++) {
-			if (buffer[k] == 0) {
-                pk = k;
+    return true;
+}
+
+void try_delete(int order, int start, int end, ResourceMask resources, Tracker* tracker) {
+    assert(order > 0);
+    for (ResourceMask m = resources; m; m &= m - 1) {
+        unsigned r = resource_mask_first(m);
+        if (tracker->ops->find) {
+            int k = tracker->ops->find(tracker->index[r], start, end, order);
+            assert(k >= 0);
+            tracker_write(tracker, r, (unsigned)k, start, end, 0, order);
+            continue;
+        }
+
+        unsigned capacity = resource_get(r)->capacity;
+        int buffer[capacity];
+        tracker->ops->range_query(tracker->index[r], start, end, buffer);
+        for (unsigned k = 0; k < capacity; k++) {
+            if (buffer[k] == order) {
+                tracker_write(tracker, r, k, start, end, 0, order);
                 break;
             }
-            if (k == 9) return false;
-		}
-	}
-
-    SegTree* st_list[3] = {
-        tracker->bc,
-        tracker->lu,
-        tracker->vi
-    };
-
-    if (essential > 0) {
-        for (int e = 0; e < 3; e++) {
-            if (essential & (1 << (2 - e))) {
-                int buffer[3];
-                segtree_range_query(st_list[e], start, end, buffer);
-                for (unsigned k = 0; k < 3; k++) {
-                    if (buffer[k] == 0) {
-                        ek[e] = k;
-                        break;
-                    }
-                    if (k == 2) return false;
-                }
-            }
+            assert(k != capacity - 1);
         }
     }
+}
+
+// A booking as seen by assign_slots(): [start, end] of bookings[index].
+typedef struct SlotInterval {
+    int start;
+    int end;
+    int index;
+} SlotInterval;
+
+static int cmp_slot_interval(const void* a, const void* b) {
+    const SlotInterval* ia = a;
+    const SlotInterval* ib = b;
+    if (ia->start != ib->start) return ia->start < ib->start ? -1 : 1;
+    return ia->index - ib->index;
+}
+
+// Binary min-heaps of busy slots ordered by end, and of free slot numbers.
+static void heap_push(int* heap, int* size, int val, const int* key) {
+    int i = (*size)++;
+    while (i > 0 && key[heap[(i - 1) / 2]] > key[val]) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = val;
+}
 
-    if (pk != 999) {
-        segtree_range_set(tracker->park, pk, start, end, order);
+static int heap_pop(int* heap, int* size, const int* key) {
+    int top = heap[0], last = heap[--(*size)], i = 0;
+    for (int c = 1; c < *size; i = c, c = 2 * c + 1) {
+        if (c + 1 < *size && key[heap[c + 1]] < key[heap[c]]) c++;
+        if (key[heap[c]] >= key[last]) break;
+        heap[i] = heap[c];
     }
+    heap[i] = last;
+    return top;
+}
 
-    for (int i = 0; i < 3; i++) {
-        if (ek[i] != 999) {
-            segtree_range_set(st_list[i], ek[i], start, end, order);
+bool assign_slots(const Vector* bookings, unsigned r, int* slots) {
+    const int capacity = (int)resource_get(r)->capacity;
+    SlotInterval* intervals = malloc((size_t)(bookings->size + 1) * sizeof(SlotInterval));
+    int* busy = malloc((size_t)capacity * sizeof(int));         // slots in use, by ending time
+    int* idle = malloc((size_t)capacity * sizeof(int));         // free slots, lowest first
+    int* slot_end = malloc((size_t)capacity * sizeof(int));
+    int* slot_id = malloc((size_t)capacity * sizeof(int));
+    if (!intervals || !busy || !idle || !slot_end || !slot_id) exit(1);
+
+    int n = 0;
+    for (int i = 0; i < bookings->size; i++) {
+        const Request* req = &bookings->data[i];
+        slots[i] = -1;
+        if (req->resources & RESOURCE_BIT(r)) {
+            intervals[n++] = (SlotInterval){req->start, req->start + req->duration - 1, i};
         }
     }
+    qsort(intervals, (size_t)n, sizeof(SlotInterval), cmp_slot_interval);
 
-    return true;
-}
+    int busy_size = 0, idle_size = 0;
+    for (int k = 0; k < capacity; k++) {
+        slot_id[k] = k;
+        heap_push(idle, &idle_size, k, slot_id);
+    }
 
-void try_delete(int order, int start, int end, bool parking, char essential, Tracker* tracker) {
-    assert(order > 0);
-    if (parking) {
-        int buffer[10];
-        segtree_range_query(tracker->park, start, end, buffer);
-        for (unsigned k = 0; k < 10; k++) {
-            if (buffer[k] == order) {
-                segtree_range_set(tracker->park, k, start, end, 0);
-                break;
-            }
-            assert(k != 9);
+    // Greedy colouring of an interval graph in order of start time uses exactly as many colours
+    // as the largest number of overlapping intervals, so it fails only on an overbooked resource.
+    bool ok = true;
+    for (int i = 0; i < n && ok; i++) {
+        while (busy_size > 0 && slot_end[busy[0]] < intervals[i].start) {
+            heap_push(idle, &idle_size, heap_pop(busy, &busy_size, slot_end), slot_id);
+        }
+        if (idle_size == 0) {
+            ok = false;
+            break;
         }
+        int k = heap_pop(idle, &idle_size, slot_id);
+        slots[intervals[i].index] = k;
+        slot_end[k] = intervals[i].end;
+        heap_push(busy, &busy_size, k, slot_end);
     }
 
-    if (essential > 0) {
-        SegTree* st_list[3] = {
-            tracker->bc,
-            tracker->lu,
-            tracker->vi
-        };
-        for (int e = 0; e < 3; e++) {
-            if (essential & (1 << (2 - e))) {
-                int buffer[3];
-                segtree_range_query(st_list[e], start, end, buffer);
-                for (unsigned k = 0; k < 3; k++) {
-                    if (buffer[k] == order) {
-                        segtree_range_set(st_list[e], k, start, end, 0);
-                        break;
-                    }
-                    assert(k != 2);
-                }
-            }
+    free(intervals);
+    free(busy);
+    free(idle);
+    free(slot_end);
+    free(slot_id);
+    return ok;
+}
+
+void fill_tracker(Tracker* tracker, const Vector* bookings) {
+    int* slots = malloc((size_t)(bookings->size + 1) * sizeof(int));
+    if (slots == NULL) exit(1);
+    for (unsigned r = 0; r < tracker->n_resources; r++) {
+        bool ok = assign_slots(bookings, r, slots);
+        assert(ok);
+        (void)ok;
+        for (int i = 0; i < bookings->size; i++) {
+            if (slots[i] < 0) continue;
+            const Request* req = &bookings->data[i];
+            tracker_write(tracker, r, (unsigned)slots[i],
+                          req->start, req->start + req->duration - 1, req->order, 0);
         }
     }
-}
\ No newline at end of file
+    free(slots);
+}
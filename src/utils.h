@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,16 +38,62 @@ char** split(const char*);
 
 bool compare(const char*, const char*);
 
-int parse_time(const char*, const char*);
-int parse_duration(const char*);
-char parse_member(const char*);
+#define MAX_HORIZON_DAYS    3660    // ten years
+#define DATE_STRING_LEN     11      // "YYYY-MM-DD" and '\0'
+
+_Static_assert(MAX_HORIZON_DAYS * 24 * 60 <= (1 << REQUEST_TIME_BITS), "Request.start cannot hold the horizon");
+
+/*
+ * Sets the booking horizon to the whole days from `first` to `last` (both YYYY-MM-DD, inclusive).
+ * Defaults to 2025-05-10 ~ 2025-05-16. Must be called before any Tracker is built.
+ * Returns false, leaving the horizon unchanged, if either date is invalid or the range is
+ * empty or longer than MAX_HORIZON_DAYS.
+ */
+bool set_horizon(const char* first, const char* last);
+
+// Length of the horizon. Times are minutes in [0, horizon_minutes()).
+int horizon_minutes(void);
+
+// First day of the horizon, in days since 1970-01-01.
+int horizon_start_day(void);
+
+// Writes the YYYY-MM-DD date of a time (minutes since the start of the horizon).
+void format_date(int minutes, char date[DATE_STRING_LEN]);
+
+int parse_time(StringView date, StringView time);
+int parse_duration(StringView duration);
+char parse_member(StringView member);
 bool is_valid_essentials_pair(const char*, const char*);
 const char* get_valid_pair(const char*);
-void add_essential_value(char*, const char*);
-int get_priority(const char*);
-bool is_valid_essentials(const char*);
+void add_essential_value(ResourceMask*, StringView essential);
+bool is_valid_essentials(StringView essential);
+
+/*
+ * Hashes the ASCII-lowercased bytes of s, for the perfect hash tables of keywords and item names.
+ */
+uint32_t hash_lowercase(const char* s, size_t len, uint32_t seed);
+
+/*
+ * Returns whether s, lowercased, is the NUL-terminated lowercase string `lower`.
+ */
+bool equals_lowercase(const char* s, size_t len, const char* lower);
+
+bool try_put(int order, int start, int end, ResourceMask resources, Tracker* tracker);
+void try_delete(int order, int start, int end, ResourceMask resources, Tracker* tracker);
 
-bool try_put(int order, int start, int end, bool parking, char essential, Tracker* tracker);
-void try_delete(int order, int start, int end, bool parking, char essential, Tracker* tracker);
+/*
+ * Numbers the slots of resource r used by a set of bookings, by colouring their interval graph.
+ * Needed by backends that only count busy slots (TRACKER_COUNTING), and cheap enough to run only
+ * when the slots are printed.
+ * slots[i] receives the slot of bookings->data[i], or -1 if it does not use resource r.
+ * Returns false if the bookings need more than the capacity of r (they were overbooked).
+ */
+bool assign_slots(const Vector* bookings, unsigned r, int* slots);
+
+/*
+ * Books every request of `bookings` into an empty tracker, on the slots assign_slots() picks.
+ * Unlike calling try_put() in turn, this never fails for a set of bookings that fits.
+ */
+void fill_tracker(Tracker* tracker, const Vector* bookings);
 
 #endif //UTILS_H
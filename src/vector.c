@@ -1,10 +1,20 @@
 #include "vector.h"
 #include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define INIT_CAPACITY 20
 
+static atomic_ulong allocations = 0;   // batch files are parsed into vectors by several threads
+
+unsigned long vector_allocations(void) {
+    return allocations;
+}
+
 void vector_init(Vector *vec) {
+    allocations++;
     vec->data = malloc(INIT_CAPACITY * sizeof(Request));
     vec->capacity = INIT_CAPACITY;
     vec->size = 0;
@@ -13,6 +23,7 @@ void vector_init(Vector *vec) {
 void vector_add(Vector *vec, Request req) {
     if (vec->size >= vec->capacity) {
         int new_capacity = vec->capacity == 0 ? 1 : vec->capacity * 2;
+        allocations++;
         Request *new_data = realloc(vec->data, (size_t)new_capacity * sizeof(Request));
         if (!new_data) exit(1);
         vec->data = new_data;
@@ -21,21 +32,34 @@ void vector_add(Vector *vec, Request req) {
     vec->data[vec->size++] = req;
 }
 
+void vector_reserve(Vector *vec, int capacity) {
+    if (vec->capacity >= capacity) return;
+    allocations++;
+    Request *new_data = realloc(vec->data, (size_t)capacity * sizeof(Request));
+    if (!new_data) exit(1);
+    vec->data = new_data;
+    vec->capacity = capacity;
+}
+
+void vector_append(Vector *vec, const Request *reqs, int count) {
+    if (count <= 0) return;
+    if (vec->size + count > vec->capacity) {
+        // grow geometrically, as adding the requests one by one would
+        int capacity = vec->capacity > 0 ? vec->capacity : 1;
+        while (capacity < vec->size + count) capacity = capacity > INT_MAX / 2 ? vec->size + count : capacity * 2;
+        vector_reserve(vec, capacity);
+    }
+    memcpy(vec->data + vec->size, reqs, (size_t)count * sizeof(Request));
+    vec->size += count;
+}
+
 void vector_free(Vector *vec) {
     free(vec->data);
     vec->data = NULL;
     vec->size = vec->capacity = 0;
 }
 
-void vector_deepfree(Vector *vec) {
-    for (int i = 0; i < vec->size; i++) {
-        free(vec->data[i].file);
-        free(vec->data[i].algo);
-    }
-    vector_free(vec);
-}
-
-static int is_work_hour(int start, int end) {
+int is_work_hour(int start, int end) {
     // check if [start, end] within 8:00 AM ~ 8:00 PM
     assert(start <= end);
     int start_h = (start % (24 * 60)) / 60;
@@ -62,14 +86,8 @@ int cmp_duration(const void *a, const void *b) {
 int cmp_volume_cnt(const void *a, const void *b) {
     const Request *ra = (const Request*)a;
     const Request *rb = (const Request*)b;
-    int a_cnt = 0, b_cnt = 0;
-    a_cnt += (ra->parking) ? 1 : 0;
-    b_cnt += (rb->parking) ? 1 : 0;
-    for (int i = 0; i < 3; i++) {
-        int mask = (1 << (2 - i));
-        if (ra->essential & mask) a_cnt++;
-        if (rb->essential & mask) b_cnt++;
-    }
+    int a_cnt = (int)resource_mask_count(ra->resources);
+    int b_cnt = (int)resource_mask_count(rb->resources);
     int tmp = rb->duration * b_cnt - ra->duration * a_cnt; 
     if (tmp != 0) return tmp;
     return b_cnt - a_cnt;
@@ -81,11 +99,8 @@ void vector_qsort(Vector *vec, int l, int r, int (*cmp)(const void*, const void*
     qsort(vec->data + l, (size_t)(r - l + 1), sizeof(Request), cmp);
 }
 
-void vector_overwrite(Vector* source, Vector* target) {
-    vector_free(target);
-    target->data = malloc((unsigned)source->capacity * sizeof(Request));
-    target->capacity = source->capacity;
-    for (int i = 0; i < source->size; i++) {
-        vector_add(target, source->data[i]);
-    }
+void vector_overwrite(const Vector* source, Vector* target) {
+    vector_reserve(target, source->size);
+    if (source->size > 0) memcpy(target->data, source->data, (size_t)source->size * sizeof(Request));
+    target->size = source->size;
 }
@@ -14,8 +14,17 @@ typedef struct Vector {
 
 void vector_init(Vector *vec);
 void vector_add(Vector *vec, Request req);
+
+/**
+ * Makes sure the vector can hold at least `capacity` requests without reallocating
+ */
+void vector_reserve(Vector *vec, int capacity);
+
+/**
+ * Adds count requests at once, as they are
+ */
+void vector_append(Vector *vec, const Request *reqs, int count);
 void vector_free(Vector *vec);
-void vector_deepfree(Vector *vec);
 
 /**
  * Sort the [l, r] segment of the vector using quick sort algorithm. l, r are both inclusive
@@ -25,7 +34,21 @@ void vector_deepfree(Vector *vec);
  * @param cmp The comparison function
  */
 void vector_qsort(Vector *vec, int l, int r, int (*cmp)(const void*, const void*));
-void vector_overwrite(Vector* vec, Vector* target);
+
+/**
+ * Copies the requests of vec into target, reusing target's buffer if it is large enough
+ */
+void vector_overwrite(const Vector* vec, Vector* target);
+
+/**
+ * @return The number of times any vector has allocated or grown its buffer so far
+ */
+unsigned long vector_allocations(void);
+
+/**
+ * @return 1 if [start, end] lies within 8:00 AM ~ 8:00 PM of a day, 0 otherwise
+ */
+int is_work_hour(int start, int end);
 
 int cmp_priority(const void *a, const void *b);
 int cmp_duration(const void *a, const void *b);